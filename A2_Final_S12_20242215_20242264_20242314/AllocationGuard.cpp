@@ -0,0 +1,68 @@
+#include "AllocationGuard.h"
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	thread_local bool allocationsForbidden = false;
+
+	void checkAllocation() noexcept
+	{
+		if (allocationsForbidden)
+		{
+			// The assertion/logging machinery may allocate itself
+			allocationsForbidden = false;
+			jassertfalse; // heap allocation inside the audio callback
+			allocationsForbidden = true;
+		}
+	}
+}
+
+void AllocationGuard::setAllocationsForbidden(bool shouldForbid) noexcept
+{
+	allocationsForbidden = shouldForbid;
+}
+
+bool AllocationGuard::areAllocationsForbidden() noexcept
+{
+	return allocationsForbidden;
+}
+
+#if PLAYER_ASSERT_NO_AUDIO_ALLOCATIONS
+
+// ==================== GLOBAL ALLOCATION HOOKS ====================
+
+void* operator new(std::size_t size)
+{
+	checkAllocation();
+
+	if (auto* ptr = std::malloc(size == 0 ? 1 : size))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	checkAllocation();
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Debug check for the real-time path: while a ScopedNoAllocation is alive on a
+// thread, any heap allocation made by that same thread hits a jassert.
+// The global operator new replacement that performs the check lives in
+// AllocationGuard.cpp and is only compiled in when the check is enabled.
+#ifndef PLAYER_ASSERT_NO_AUDIO_ALLOCATIONS
+ #define PLAYER_ASSERT_NO_AUDIO_ALLOCATIONS JUCE_DEBUG
+#endif
+
+namespace AllocationGuard
+{
+	void setAllocationsForbidden(bool shouldForbid) noexcept;
+	bool areAllocationsForbidden() noexcept;
+
+	class ScopedNoAllocation
+	{
+	public:
+		ScopedNoAllocation() noexcept
+		{
+		   #if PLAYER_ASSERT_NO_AUDIO_ALLOCATIONS
+			wasForbidden = areAllocationsForbidden();
+			setAllocationsForbidden(true);
+		   #endif
+		}
+
+		~ScopedNoAllocation() noexcept
+		{
+		   #if PLAYER_ASSERT_NO_AUDIO_ALLOCATIONS
+			setAllocationsForbidden(wasForbidden);
+		   #endif
+		}
+
+	private:
+		bool wasForbidden = false;
+
+		JUCE_DECLARE_NON_COPYABLE(ScopedNoAllocation)
+	};
+}
@@ -0,0 +1,100 @@
+#include "AudioProfiler.h"
+
+void AudioProfiler::prepare(double newSampleRate)
+{
+	sampleRate = newSampleRate;
+	preparedTicks = juce::Time::getHighResolutionTicks();
+	previousStartTicks = 0;
+}
+
+void AudioProfiler::beginCallback() noexcept
+{
+	callbackStartTicks = juce::Time::getHighResolutionTicks();
+	current.numDecks = 0;
+}
+
+void AudioProfiler::setDeckTicks(int deckIndex, juce::int64 sourceTicks, juce::int64 stretchTicks, juce::int64 eqTicks, juce::int64 fadeTicks) noexcept
+{
+	if (!juce::isPositiveAndBelow(deckIndex, maxDecks))
+		return;
+
+	auto& deck = current.decks[deckIndex];
+	deck.sourceMs = (float)((double)sourceTicks * msPerTick);
+	deck.stretchMs = (float)((double)stretchTicks * msPerTick);
+	deck.eqMs = (float)((double)eqTicks * msPerTick);
+	deck.fadeMs = (float)((double)fadeTicks * msPerTick);
+	current.numDecks = juce::jmax(current.numDecks, deckIndex + 1);
+}
+
+void AudioProfiler::endCallback(int numSamples) noexcept
+{
+	const auto endTicks = juce::Time::getHighResolutionTicks();
+
+	if (sampleRate <= 0.0 || numSamples <= 0)
+		return;
+
+	const double budgetMs = 1000.0 * numSamples / sampleRate;
+
+	current.timeSeconds = (double)(callbackStartTicks - preparedTicks) * msPerTick / 1000.0;
+	current.numSamples = numSamples;
+	current.callbackMs = (float)((double)(endTicks - callbackStartTicks) * msPerTick);
+	current.budgetPercent = (float)(100.0 * current.callbackMs / budgetMs);
+	current.intervalMs = previousStartTicks != 0 ? (float)((double)(callbackStartTicks - previousStartTicks) * msPerTick) : 0.0f;
+	previousStartTicks = callbackStartTicks;
+
+	numCallbacks.fetch_add(1, std::memory_order_relaxed);
+
+	const int bin = juce::jmin(numHistogramBins - 1, (int)(current.budgetPercent / (float)histogramBinPercent));
+	histogram[(size_t)bin].fetch_add(1, std::memory_order_relaxed);
+
+	// An overrun leaves the device short of audio. A late callback means the
+	// device (or the OS) held the thread up, which shows up as a gap between
+	// callbacks well beyond the block's own length.
+	if (current.budgetPercent > 100.0f)
+		numOverruns.fetch_add(1, std::memory_order_relaxed);
+
+	if (current.intervalMs > 1.5 * budgetMs)
+		numLateCallbacks.fetch_add(1, std::memory_order_relaxed);
+
+	if (recordsEnabled.load(std::memory_order_relaxed) && !records.push(current))
+		numDroppedRecords.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioProfiler::resetCounters() noexcept
+{
+	numCallbacks.store(0);
+	numOverruns.store(0);
+	numLateCallbacks.store(0);
+	numDroppedRecords.store(0);
+
+	for (auto& count : histogram)
+		count.store(0);
+}
+
+juce::String AudioProfiler::getCsvHeader(int numDecks)
+{
+	juce::String header("time_s,samples,callback_ms,budget_percent,interval_ms");
+
+	for (int d = 0; d < juce::jmin(numDecks, maxDecks); ++d)
+		header << ",deck" << (d + 1) << "_source_ms,deck" << (d + 1) << "_stretch_ms,deck" << (d + 1) << "_eq_ms,deck" << (d + 1) << "_fade_ms";
+
+	return header;
+}
+
+void AudioProfiler::writeCsvLine(juce::OutputStream& out, const Record& record, int numDecks)
+{
+	out << juce::String(record.timeSeconds, 6) << ',' << record.numSamples << ','
+		<< juce::String(record.callbackMs, 4) << ',' << juce::String(record.budgetPercent, 2) << ','
+		<< juce::String(record.intervalMs, 4);
+
+	for (int d = 0; d < juce::jmin(numDecks, maxDecks); ++d)
+	{
+		if (d < record.numDecks)
+			out << ',' << juce::String(record.decks[d].sourceMs, 4) << ',' << juce::String(record.decks[d].stretchMs, 4)
+				<< ',' << juce::String(record.decks[d].eqMs, 4) << ',' << juce::String(record.decks[d].fadeMs, 4);
+		else
+			out << ",,,,";
+	}
+
+	out << '\n';
+}
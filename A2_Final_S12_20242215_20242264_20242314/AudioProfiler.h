@@ -0,0 +1,97 @@
+#pragma once
+#include <JuceHeader.h>
+#include "RealtimeParameters.h"
+#include "DeckMixer.h"
+
+// ==================== AUDIO PROFILER ====================
+
+// Times every audio callback and the stages each deck spends it in, to show
+// how much headroom the audio thread has on the machine it runs on.
+//
+// The audio thread keeps a histogram of callback times (as a share of the
+// time the block lasts) and counts overruns and late callbacks, all in
+// atomics that any thread can read. While records are enabled it also
+// pushes one Record per callback into a lock-free ring, for a single reader
+// on the message thread to draw or log. If the reader falls behind, records
+// are dropped and counted rather than ever making the audio thread wait.
+class AudioProfiler
+{
+public:
+	// As many decks as the mixer can hold
+	static constexpr int maxDecks = DeckMixer::defaultMaxDecks;
+
+	// 5% of the block's duration per bin; the last bin takes everything from 200% up
+	static constexpr int histogramBinPercent = 5;
+	static constexpr int numHistogramBins = 41;
+
+	struct DeckTimes
+	{
+		// Decoding and sample rate conversion, up to the transport
+		float sourceMs = 0.0f;
+		// Time-stretching and gapless transitions
+		float stretchMs = 0.0f;
+		// EQ and filters
+		float eqMs = 0.0f;
+		// Fade ramp and output gain
+		float fadeMs = 0.0f;
+	};
+
+	struct Record
+	{
+		// Since the device was prepared
+		double timeSeconds = 0.0;
+		int numSamples = 0;
+		float callbackMs = 0.0f;
+		float budgetPercent = 0.0f;
+		// Since the previous callback started
+		float intervalMs = 0.0f;
+		int numDecks = 0;
+		DeckTimes decks[maxDecks];
+	};
+
+	// Before callbacks start
+	void prepare(double sampleRate);
+
+	// Audio thread
+	void beginCallback() noexcept;
+	void setDeckTicks(int deckIndex, juce::int64 sourceTicks, juce::int64 stretchTicks, juce::int64 eqTicks, juce::int64 fadeTicks) noexcept;
+	void endCallback(int numSamples) noexcept;
+
+	// Any thread
+	int getNumCallbacks() const noexcept { return numCallbacks.load(std::memory_order_relaxed); }
+	int getNumOverruns() const noexcept { return numOverruns.load(std::memory_order_relaxed); }
+	int getNumLateCallbacks() const noexcept { return numLateCallbacks.load(std::memory_order_relaxed); }
+	int getNumDroppedRecords() const noexcept { return numDroppedRecords.load(std::memory_order_relaxed); }
+	int getHistogramCount(int bin) const noexcept { return histogram[(size_t)bin].load(std::memory_order_relaxed); }
+	void resetCounters() noexcept;
+
+	void setRecordsEnabled(bool shouldRecord) noexcept { recordsEnabled.store(shouldRecord); }
+	bool areRecordsEnabled() const noexcept { return recordsEnabled.load(); }
+
+	// Message thread, one reader only
+	template <typename Handler>
+	void readRecords(Handler&& handle) { records.drain(std::forward<Handler>(handle)); }
+
+	// The CSV header matching writeCsvLine, with columns for numDecks decks
+	static juce::String getCsvHeader(int numDecks);
+	static void writeCsvLine(juce::OutputStream& out, const Record& record, int numDecks);
+
+private:
+	double sampleRate = 0.0;
+	double msPerTick = 1000.0 / (double)juce::Time::getHighResolutionTicksPerSecond();
+
+	// Audio thread
+	juce::int64 preparedTicks = 0;
+	juce::int64 callbackStartTicks = 0;
+	juce::int64 previousStartTicks = 0;
+	Record current;
+
+	std::atomic<int> numCallbacks{ 0 };
+	std::atomic<int> numOverruns{ 0 };
+	std::atomic<int> numLateCallbacks{ 0 };
+	std::atomic<int> numDroppedRecords{ 0 };
+	std::array<std::atomic<int>, numHistogramBins> histogram{};
+
+	std::atomic<bool> recordsEnabled{ false };
+	CommandQueue<Record, 1024> records;
+};
@@ -0,0 +1,32 @@
+#include "CellTextCache.h"
+
+CellTextCache::CellTextCache(const juce::Font& fontToUse, int maxEntriesToKeep)
+	: font(fontToUse), maxEntries(maxEntriesToKeep)
+{
+}
+
+void CellTextCache::draw(juce::Graphics& g, juce::int64 key, const juce::String& text, juce::Rectangle<int> area)
+{
+	if (area.isEmpty())
+		return;
+
+	// Only the rows on screen are ever drawn, so rather than tracking use,
+	// start again once enough rows have been scrolled past
+	if ((int)entries.size() >= maxEntries && entries.find(key) == entries.end())
+		entries.clear();
+
+	auto& entry = entries[key];
+
+	if (entry.width != area.getWidth() || entry.height != area.getHeight() || entry.text != text)
+	{
+		const float baseline = ((float)area.getHeight() - font.getHeight()) * 0.5f + font.getAscent();
+
+		entry.glyphs.clear();
+		entry.glyphs.addCurtailedLineOfText(font, text, 0.0f, baseline, (float)area.getWidth(), true);
+		entry.text = text;
+		entry.width = area.getWidth();
+		entry.height = area.getHeight();
+	}
+
+	entry.glyphs.draw(g, juce::AffineTransform::translation((float)area.getX(), (float)area.getY()));
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== CELL TEXT CACHE ====================
+
+// Laid-out text for table cells, kept between paints. Fitting a string into
+// a cell means shaping every glyph and measuring it against the width, which
+// is most of what drawing a row costs; with this, a row that has been drawn
+// before only has to draw its glyphs. Entries are keyed by the caller (row
+// and column, say) and rebuilt if the text or the cell size changes.
+class CellTextCache
+{
+public:
+	explicit CellTextCache(const juce::Font& fontToUse, int maxEntriesToKeep = 2048);
+
+	// Draws text on one line, centred vertically and left-aligned in area,
+	// cut short with an ellipsis if it doesn't fit. Uses the current colour.
+	void draw(juce::Graphics& g, juce::int64 key, const juce::String& text, juce::Rectangle<int> area);
+
+	void clear() { entries.clear(); }
+	int getNumEntries() const { return (int)entries.size(); }
+
+private:
+	struct Entry
+	{
+		juce::String text;
+		int width = -1;
+		int height = -1;
+		juce::GlyphArrangement glyphs;
+	};
+
+	juce::Font font;
+	int maxEntries;
+	std::unordered_map<juce::int64, Entry> entries;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CellTextCache)
+};
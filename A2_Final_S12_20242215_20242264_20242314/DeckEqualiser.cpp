@@ -0,0 +1,385 @@
+#include "DeckEqualiser.h"
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#elif JUCE_ARM && defined(__ARM_NEON)
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+	constexpr float flatGainSetting = -DeckEqualiser::minimumGainDecibels
+		/ (DeckEqualiser::maximumGainDecibels - DeckEqualiser::minimumGainDecibels);
+
+	constexpr float filterQ = 0.7071f;
+	constexpr float midQ = 0.7f;
+}
+
+DeckEqualiser::DeckEqualiser()
+{
+	for (int stage = LowShelf; stage <= HighShelf; ++stage)
+		settings[stage].set(flatGainSetting);
+
+	settings[HighPass].set(0.0f);
+	settings[LowPass].set(1.0f);
+}
+
+float DeckEqualiser::gainToSetting(float decibels) noexcept
+{
+	return (juce::jlimit(minimumGainDecibels, maximumGainDecibels, decibels) - minimumGainDecibels)
+		/ (maximumGainDecibels - minimumGainDecibels);
+}
+
+float DeckEqualiser::settingToGain(float setting) noexcept
+{
+	return minimumGainDecibels + setting * (maximumGainDecibels - minimumGainDecibels);
+}
+
+float DeckEqualiser::frequencyToSetting(float frequency) noexcept
+{
+	return std::log(juce::jlimit(minimumFrequency, maximumFrequency, frequency) / minimumFrequency)
+		/ std::log(maximumFrequency / minimumFrequency);
+}
+
+float DeckEqualiser::settingToFrequency(float setting) noexcept
+{
+	return minimumFrequency * std::pow(maximumFrequency / minimumFrequency, setting);
+}
+
+int DeckEqualiser::getBandStage(Band band) noexcept
+{
+	return band == Band::Low ? LowShelf : band == Band::Mid ? MidPeak : HighShelf;
+}
+
+void DeckEqualiser::setBandGainDecibels(Band band, float decibels) noexcept
+{
+	settings[getBandStage(band)].set(gainToSetting(decibels));
+}
+
+float DeckEqualiser::getBandGainDecibels(Band band) const noexcept
+{
+	return settingToGain(settings[getBandStage(band)].get());
+}
+
+void DeckEqualiser::setHighPassFrequency(float frequency) noexcept { settings[HighPass].set(frequencyToSetting(frequency)); }
+void DeckEqualiser::setLowPassFrequency(float frequency) noexcept { settings[LowPass].set(frequencyToSetting(frequency)); }
+float DeckEqualiser::getHighPassFrequency() const noexcept { return settingToFrequency(settings[HighPass].get()); }
+float DeckEqualiser::getLowPassFrequency() const noexcept { return settingToFrequency(settings[LowPass].get()); }
+
+void DeckEqualiser::prepare(double newSampleRate) noexcept
+{
+	sampleRate = newSampleRate;
+
+	for (auto& setting : settings)
+		setting.prepare(sampleRate, smoothingSeconds);
+
+	for (int stage = 0; stage < numStages; ++stage)
+		for (int c = 0; c < maxChannels; ++c)
+			state1[stage][c] = state2[stage][c] = 0.0f;
+
+	updateStages(0, true);
+}
+
+bool DeckEqualiser::isFlat(int stage, float setting) const noexcept
+{
+	switch (stage)
+	{
+	case HighPass: return setting <= 0.0f;
+	case LowPass:  return setting >= 1.0f;
+	default:       return std::abs(setting - flatGainSetting) < 1.0e-4f;
+	}
+}
+
+DeckEqualiser::Coefficients DeckEqualiser::design(int stage, float setting) const noexcept
+{
+	float frequency;
+
+	switch (stage)
+	{
+	case LowShelf:  frequency = lowShelfFrequency; break;
+	case MidPeak:   frequency = midFrequency; break;
+	case HighShelf: frequency = highShelfFrequency; break;
+	default:        frequency = settingToFrequency(setting); break;
+	}
+
+	const double w0 = juce::MathConstants<double>::twoPi * juce::jmin((double)frequency, sampleRate * 0.49) / sampleRate;
+	const double cosW0 = std::cos(w0);
+	const double alpha = std::sin(w0) / (2.0 * (stage == MidPeak ? midQ : filterQ));
+	const double a = std::pow(10.0, settingToGain(setting) / 40.0);
+	const double shelfAlpha = 2.0 * std::sqrt(a) * alpha;
+
+	double b0, b1, b2, a0, a1, a2;
+
+	switch (stage)
+	{
+	case HighPass:
+		b0 = b2 = (1.0 + cosW0) / 2.0;
+		b1 = -(1.0 + cosW0);
+		a0 = 1.0 + alpha; a1 = -2.0 * cosW0; a2 = 1.0 - alpha;
+		break;
+
+	case LowPass:
+		b0 = b2 = (1.0 - cosW0) / 2.0;
+		b1 = 1.0 - cosW0;
+		a0 = 1.0 + alpha; a1 = -2.0 * cosW0; a2 = 1.0 - alpha;
+		break;
+
+	case MidPeak:
+		b0 = 1.0 + alpha * a; b1 = -2.0 * cosW0; b2 = 1.0 - alpha * a;
+		a0 = 1.0 + alpha / a; a1 = -2.0 * cosW0; a2 = 1.0 - alpha / a;
+		break;
+
+	case LowShelf:
+		b0 = a * ((a + 1.0) - (a - 1.0) * cosW0 + shelfAlpha);
+		b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosW0);
+		b2 = a * ((a + 1.0) - (a - 1.0) * cosW0 - shelfAlpha);
+		a0 = (a + 1.0) + (a - 1.0) * cosW0 + shelfAlpha;
+		a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosW0);
+		a2 = (a + 1.0) + (a - 1.0) * cosW0 - shelfAlpha;
+		break;
+
+	case HighShelf:
+	default:
+		b0 = a * ((a + 1.0) + (a - 1.0) * cosW0 + shelfAlpha);
+		b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosW0);
+		b2 = a * ((a + 1.0) + (a - 1.0) * cosW0 - shelfAlpha);
+		a0 = (a + 1.0) - (a - 1.0) * cosW0 + shelfAlpha;
+		a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosW0);
+		a2 = (a + 1.0) - (a - 1.0) * cosW0 - shelfAlpha;
+		break;
+	}
+
+	return { (float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0), (float)(a1 / a0), (float)(a2 / a0) };
+}
+
+void DeckEqualiser::updateStages(int numSamples, bool force) noexcept
+{
+	numActiveStages = 0;
+
+	for (int stage = 0; stage < numStages; ++stage)
+	{
+		const float setting = settings[stage].advance(numSamples).end;
+
+		if (force || setting != designedSettings[stage])
+		{
+			designedSettings[stage] = setting;
+			coefficients[stage] = design(stage, setting);
+		}
+
+		if (isFlat(stage, setting))
+		{
+			// Starts from rest when it comes back into the cascade
+			for (int c = 0; c < maxChannels; ++c)
+				state1[stage][c] = state2[stage][c] = 0.0f;
+		}
+		else
+		{
+			activeStages[numActiveStages++] = stage;
+		}
+	}
+}
+
+void DeckEqualiser::process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+{
+	const int numChannels = bufferToFill.buffer->getNumChannels();
+
+	if (numChannels == 0 || sampleRate <= 0.0)
+		return;
+
+	const juce::ScopedNoDenormals noDenormals;
+
+	for (int offset = 0; offset < bufferToFill.numSamples; offset += updateInterval)
+	{
+		const int numSamples = juce::jmin(updateInterval, bufferToFill.numSamples - offset);
+		updateStages(numSamples, false);
+
+		if (numActiveStages == 0)
+			continue;
+
+		// A mono buffer runs through both lanes and gets the same result twice
+		float* channels[maxChannels];
+
+		for (int c = 0; c < maxChannels; ++c)
+			channels[c] = bufferToFill.buffer->getWritePointer(juce::jmin(c, numChannels - 1), bufferToFill.startSample + offset);
+
+		processChunk(channels, numSamples);
+	}
+}
+
+void DeckEqualiser::processChunk(float* const* channels, int numSamples) noexcept
+{
+	float* left = channels[0];
+	float* right = channels[1];
+
+	// Left and right share one vector register, so each stage costs the same
+	// handful of multiply-adds per sample whether there are one or two channels.
+	// The coefficients are broadcast and the states loaded once per chunk.
+   #if JUCE_INTEL
+	__m128 b0[numStages], b1[numStages], b2[numStages], a1[numStages], a2[numStages], z1[numStages], z2[numStages];
+
+	for (int s = 0; s < numActiveStages; ++s)
+	{
+		const int stage = activeStages[s];
+		const auto& k = coefficients[stage];
+		b0[s] = _mm_set1_ps(k.b0);
+		b1[s] = _mm_set1_ps(k.b1);
+		b2[s] = _mm_set1_ps(k.b2);
+		a1[s] = _mm_set1_ps(k.a1);
+		a2[s] = _mm_set1_ps(k.a2);
+		z1[s] = _mm_setr_ps(state1[stage][0], state1[stage][1], 0.0f, 0.0f);
+		z2[s] = _mm_setr_ps(state2[stage][0], state2[stage][1], 0.0f, 0.0f);
+	}
+
+	for (int i = 0; i < numSamples; ++i)
+	{
+		auto x = _mm_unpacklo_ps(_mm_load_ss(left + i), _mm_load_ss(right + i));
+
+		for (int s = 0; s < numActiveStages; ++s)
+		{
+			const auto y = _mm_add_ps(_mm_mul_ps(b0[s], x), z1[s]);
+			z1[s] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1[s], x), _mm_mul_ps(a1[s], y)), z2[s]);
+			z2[s] = _mm_sub_ps(_mm_mul_ps(b2[s], x), _mm_mul_ps(a2[s], y));
+			x = y;
+		}
+
+		_mm_store_ss(left + i, x);
+		_mm_store_ss(right + i, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1)));
+	}
+
+	for (int s = 0; s < numActiveStages; ++s)
+	{
+		const int stage = activeStages[s];
+		alignas(16) float lanes[4];
+
+		_mm_store_ps(lanes, z1[s]);
+		state1[stage][0] = lanes[0];
+		state1[stage][1] = lanes[1];
+
+		_mm_store_ps(lanes, z2[s]);
+		state2[stage][0] = lanes[0];
+		state2[stage][1] = lanes[1];
+	}
+   #elif JUCE_ARM && defined(__ARM_NEON)
+	float32x2_t b0[numStages], b1[numStages], b2[numStages], a1[numStages], a2[numStages], z1[numStages], z2[numStages];
+
+	for (int s = 0; s < numActiveStages; ++s)
+	{
+		const int stage = activeStages[s];
+		const auto& k = coefficients[stage];
+		b0[s] = vdup_n_f32(k.b0);
+		b1[s] = vdup_n_f32(k.b1);
+		b2[s] = vdup_n_f32(k.b2);
+		a1[s] = vdup_n_f32(k.a1);
+		a2[s] = vdup_n_f32(k.a2);
+		z1[s] = vld1_f32(state1[stage]);
+		z2[s] = vld1_f32(state2[stage]);
+	}
+
+	for (int i = 0; i < numSamples; ++i)
+	{
+		auto x = vset_lane_f32(right[i], vdup_n_f32(left[i]), 1);
+
+		for (int s = 0; s < numActiveStages; ++s)
+		{
+			const auto y = vmla_f32(z1[s], b0[s], x);
+			z1[s] = vmla_f32(vmls_f32(z2[s], a1[s], y), b1[s], x);
+			z2[s] = vmls_f32(vmul_f32(b2[s], x), a2[s], y);
+			x = y;
+		}
+
+		vst1_lane_f32(left + i, x, 0);
+		vst1_lane_f32(right + i, x, 1);
+	}
+
+	for (int s = 0; s < numActiveStages; ++s)
+	{
+		vst1_f32(state1[activeStages[s]], z1[s]);
+		vst1_f32(state2[activeStages[s]], z2[s]);
+	}
+   #else
+	for (int i = 0; i < numSamples; ++i)
+	{
+		float x[maxChannels] = { left[i], right[i] };
+
+		for (int s = 0; s < numActiveStages; ++s)
+		{
+			const int stage = activeStages[s];
+			const auto& k = coefficients[stage];
+			float* z1 = state1[stage];
+			float* z2 = state2[stage];
+
+			for (int c = 0; c < maxChannels; ++c)
+			{
+				const float y = k.b0 * x[c] + z1[c];
+				z1[c] = k.b1 * x[c] - k.a1 * y + z2[c];
+				z2[c] = k.b2 * x[c] - k.a2 * y;
+				x[c] = y;
+			}
+		}
+
+		left[i] = x[0];
+		right[i] = x[1];
+	}
+   #endif
+}
+
+// ============================== Benchmark ==============================
+
+juce::String runEqualiserBenchmark(int blockSize, double secondsOfAudio)
+{
+	juce::String result;
+	result << "Deck EQ, all five stages active, " << blockSize << "-sample blocks (us per block, % of one core)\n";
+
+	juce::Random random(1);
+	juce::AudioBuffer<float> buffer(DeckEqualiser::maxChannels, blockSize);
+	const juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+
+	for (const double sampleRate : { 44100.0, 48000.0, 96000.0 })
+	{
+		result << juce::String(sampleRate / 1000.0, 1) << " kHz:";
+
+		for (const bool sweeping : { false, true })
+		{
+			DeckEqualiser equaliser;
+			equaliser.setBandGainDecibels(DeckEqualiser::Band::Low, -12.0f);
+			equaliser.setBandGainDecibels(DeckEqualiser::Band::Mid, 3.0f);
+			equaliser.setBandGainDecibels(DeckEqualiser::Band::High, -6.0f);
+			equaliser.setHighPassFrequency(80.0f);
+			equaliser.setLowPassFrequency(12000.0f);
+			equaliser.prepare(sampleRate);
+
+			const int numBlocks = juce::jmax(1, (int)(secondsOfAudio * sampleRate / blockSize));
+			juce::int64 ticks = 0;
+
+			for (int block = 0; block < numBlocks; ++block)
+			{
+				for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+					for (int i = 0; i < blockSize; ++i)
+						buffer.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+				// Swept back and forth, so every stage is redesigned every update
+				if (sweeping)
+				{
+					const bool up = (block / 8) % 2 == 0;
+					equaliser.setBandGainDecibels(DeckEqualiser::Band::Low, up ? 0.0f : -24.0f);
+					equaliser.setBandGainDecibels(DeckEqualiser::Band::Mid, up ? 6.0f : -6.0f);
+					equaliser.setBandGainDecibels(DeckEqualiser::Band::High, up ? -3.0f : -24.0f);
+					equaliser.setHighPassFrequency(up ? 1000.0f : 40.0f);
+					equaliser.setLowPassFrequency(up ? 500.0f : 15000.0f);
+				}
+
+				const auto start = juce::Time::getHighResolutionTicks();
+				equaliser.process(info);
+				ticks += juce::Time::getHighResolutionTicks() - start;
+			}
+
+			const double seconds = juce::Time::highResolutionTicksToSeconds(ticks);
+			result << (sweeping ? ", sweeping " : " steady ") << juce::String(seconds / numBlocks * 1.0e6, 2)
+				<< " us (" << juce::String(100.0 * seconds / (numBlocks * blockSize / sampleRate), 2) << "%)";
+		}
+
+		result << "\n";
+	}
+
+	return result;
+}
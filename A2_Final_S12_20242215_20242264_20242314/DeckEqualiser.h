@@ -0,0 +1,93 @@
+#pragma once
+#include <JuceHeader.h>
+#include "RealtimeParameters.h"
+
+// ==================== DECK EQUALISER ====================
+
+// A DJ-style EQ for one deck: low shelf, mid peak and high shelf gains, and
+// a sweepable high-pass and low-pass filter. Each is one biquad (RBJ
+// cookbook designs, transposed direct form II) and they run as a cascade.
+//
+// Both channels go through the cascade together in one SSE or NEON
+// register, one pass per block, with a scalar loop on other platforms.
+// Stages that are flat are left out of the cascade, so a deck with its EQ
+// at rest costs next to nothing.
+//
+// Settings can be changed from any thread. The audio thread moves towards
+// them with a SmoothedParameter each, and redesigns the moving stages every
+// updateInterval samples, so sweeps and kills don't click.
+class DeckEqualiser
+{
+public:
+	enum class Band { Low, Mid, High };
+
+	static constexpr int maxChannels = 2;
+	static constexpr float minimumGainDecibels = -24.0f;
+	static constexpr float maximumGainDecibels = 6.0f;
+	static constexpr float minimumFrequency = 20.0f;
+	static constexpr float maximumFrequency = 20000.0f;
+
+	static constexpr float lowShelfFrequency = 120.0f;
+	static constexpr float midFrequency = 1000.0f;
+	static constexpr float highShelfFrequency = 8000.0f;
+
+	static constexpr double smoothingSeconds = 0.05;
+	static constexpr int updateInterval = 32;
+
+	DeckEqualiser();
+
+	// Any thread
+	void setBandGainDecibels(Band band, float decibels) noexcept;
+	float getBandGainDecibels(Band band) const noexcept;
+
+	// minimumFrequency turns the high-pass off, maximumFrequency the low-pass
+	void setHighPassFrequency(float frequency) noexcept;
+	void setLowPassFrequency(float frequency) noexcept;
+	float getHighPassFrequency() const noexcept;
+	float getLowPassFrequency() const noexcept;
+
+	// Before playback starts. Jumps straight to the current settings.
+	void prepare(double sampleRate) noexcept;
+
+	// Audio thread
+	void process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept;
+
+private:
+	enum Stage { HighPass, LowShelf, MidPeak, HighShelf, LowPass, numStages };
+
+	struct Coefficients
+	{
+		float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+	};
+
+	// Each stage's setting, from 0 to 1: gains linear in dB, frequencies
+	// on a log scale
+	SmoothedParameter settings[numStages];
+
+	// Audio thread
+	double sampleRate = 0.0;
+	float designedSettings[numStages] = {};
+	Coefficients coefficients[numStages];
+	float state1[numStages][maxChannels] = {};
+	float state2[numStages][maxChannels] = {};
+	int activeStages[numStages] = {};
+	int numActiveStages = 0;
+
+	void updateStages(int numSamples, bool force) noexcept;
+	bool isFlat(int stage, float setting) const noexcept;
+	Coefficients design(int stage, float setting) const noexcept;
+	void processChunk(float* const* channels, int numSamples) noexcept;
+
+	static int getBandStage(Band band) noexcept;
+	static float gainToSetting(float decibels) noexcept;
+	static float settingToGain(float setting) noexcept;
+	static float frequencyToSetting(float frequency) noexcept;
+	static float settingToFrequency(float setting) noexcept;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckEqualiser)
+};
+
+// Times one deck's EQ with every stage active and moving, at 44.1, 48 and
+// 96 kHz, and reports the cost per block and as a share of a core.
+// Run with --eq-benchmark on the command line.
+juce::String runEqualiserBenchmark(int blockSize = 256, double secondsOfAudio = 20.0);
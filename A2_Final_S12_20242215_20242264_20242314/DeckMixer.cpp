@@ -0,0 +1,191 @@
+#include "DeckMixer.h"
+
+DeckMixer::DeckMixer(int maxDecksToUse)
+	: maxDecks(juce::jmax(1, maxDecksToUse)),
+	decks(std::make_unique<Deck[]>((size_t)maxDecks))
+{
+}
+
+DeckMixer::~DeckMixer()
+{
+	setNumRenderThreads(0);
+}
+
+int DeckMixer::addDeck(PlayerAudio& deck)
+{
+	const juce::ScopedLock lock(prepareLock);
+	const int index = numDecks.load(std::memory_order_relaxed);
+
+	if (index >= maxDecks)
+	{
+		jassertfalse;
+		return -1;
+	}
+
+	decks[index].player = &deck;
+
+	if (prepared)
+		deck.prepareToPlay(blockSize, currentSampleRate);
+
+	// The audio thread only sees the deck once it is fully set up
+	numDecks.store(index + 1, std::memory_order_release);
+	return index;
+}
+
+void DeckMixer::setDeckGain(int deckIndex, float gain)
+{
+	if (juce::isPositiveAndBelow(deckIndex, maxDecks))
+		decks[deckIndex].gain.store(gain);
+}
+
+float DeckMixer::getDeckGain(int deckIndex) const
+{
+	return juce::isPositiveAndBelow(deckIndex, maxDecks) ? decks[deckIndex].gain.load() : 0.0f;
+}
+
+void DeckMixer::setDeckPan(int deckIndex, float pan)
+{
+	if (juce::isPositiveAndBelow(deckIndex, maxDecks))
+		decks[deckIndex].pan.store(juce::jlimit(-1.0f, 1.0f, pan));
+}
+
+float DeckMixer::getDeckPan(int deckIndex) const
+{
+	return juce::isPositiveAndBelow(deckIndex, maxDecks) ? decks[deckIndex].pan.load() : 0.0f;
+}
+
+void DeckMixer::setNumRenderThreads(int numThreads)
+{
+	std::unique_ptr<DeckRenderPool> newPool;
+
+	if (numThreads > 0)
+		newPool = std::make_unique<DeckRenderPool>(numThreads);
+
+	{
+		const juce::SpinLock::ScopedLockType lock(renderPoolLock);
+		std::swap(renderPool, newPool);
+	}
+
+	numRenderThreads.store(juce::jmax(0, numThreads), std::memory_order_relaxed);
+
+	// The old pool (if any) shuts its workers down here, off the audio thread
+}
+
+void DeckMixer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+	const juce::ScopedLock lock(prepareLock);
+
+	blockSize = juce::jmax(1, samplesPerBlockExpected);
+	currentSampleRate = sampleRate;
+
+	// Sized for the full capacity so adding decks later never touches this buffer
+	deckBuffers.setSize(maxDecks * numBusChannels, blockSize);
+	deckBuffers.clear();
+
+	for (int i = 0; i < getNumDecks(); ++i)
+		decks[i].player->prepareToPlay(blockSize, sampleRate);
+
+	prepared = true;
+}
+
+void DeckMixer::releaseResources()
+{
+	const juce::ScopedLock lock(prepareLock);
+
+	prepared = false;
+	blockSize = 0;
+
+	for (int i = 0; i < getNumDecks(); ++i)
+		decks[i].player->releaseResources();
+
+	deckBuffers.setSize(0, 0);
+}
+
+void DeckMixer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+	bufferToFill.clearActiveBufferRegion();
+
+	const int decksToMix = getNumDecks();
+
+	if (blockSize == 0 || decksToMix == 0)
+		return;
+
+	// Devices may deliver more than samplesPerBlockExpected; render in chunks
+	// of the prepared size rather than growing the scratch buffer here
+	for (int offset = 0; offset < bufferToFill.numSamples; offset += blockSize)
+		renderChunk(bufferToFill, offset, juce::jmin(blockSize, bufferToFill.numSamples - offset), decksToMix);
+}
+
+void DeckMixer::renderJob(int deckIndex) noexcept
+{
+	// A view onto this deck's planar slice (no allocation for <= 32 channels)
+	juce::AudioBuffer<float> deckView(chunkChannels + deckIndex * numBusChannels, numBusChannels, chunkSamples);
+	juce::AudioSourceChannelInfo deckInfo(&deckView, 0, chunkSamples);
+
+	deckInfo.clearActiveBufferRegion();
+	decks[deckIndex].player->getNextAudioBlock(deckInfo);
+}
+
+void DeckMixer::addWithGainRamp(float* dest, const float* source, float startGain, float endGain, int numSamples) noexcept
+{
+	if (startGain == endGain)
+	{
+		if (endGain != 0.0f)
+			juce::FloatVectorOperations::addWithMultiply(dest, source, endGain, numSamples);
+
+		return;
+	}
+
+	const float increment = (endGain - startGain) / (float)numSamples;
+	float gain = startGain;
+
+	for (int i = 0; i < numSamples; ++i)
+	{
+		dest[i] += source[i] * gain;
+		gain += increment;
+	}
+}
+
+void DeckMixer::renderChunk(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, int decksToMix)
+{
+	auto* const* deckChannels = deckBuffers.getArrayOfWritePointers();
+	chunkChannels = deckChannels;
+	chunkSamples = numSamples;
+
+	{
+		// Only contended while setNumRenderThreads swaps the pool, in which
+		// case this chunk simply renders serially
+		const juce::SpinLock::ScopedTryLockType lock(renderPoolLock);
+
+		if (lock.isLocked() && renderPool != nullptr && decksToMix > 1)
+		{
+			renderPool->run(*this, decksToMix);
+		}
+		else
+		{
+			for (int d = 0; d < decksToMix; ++d)
+				renderJob(d);
+		}
+	}
+
+	const int numOutputChannels = juce::jmin(bufferToFill.buffer->getNumChannels(), numBusChannels);
+
+	for (int channel = 0; channel < numOutputChannels; ++channel)
+	{
+		float* outputData = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + offset);
+
+		for (int d = 0; d < decksToMix; ++d)
+		{
+			const float gain = decks[d].gain.load(std::memory_order_relaxed);
+			const float pan = decks[d].pan.load(std::memory_order_relaxed);
+
+			// Balance law: centre leaves both sides at unity
+			float channelGain = gain;
+			if (numOutputChannels == numBusChannels)
+				channelGain *= channel == 0 ? juce::jmin(1.0f, 1.0f - pan) : juce::jmin(1.0f, 1.0f + pan);
+
+			addWithGainRamp(outputData, deckChannels[d * numBusChannels + channel], decks[d].appliedGains[channel], channelGain, numSamples);
+			decks[d].appliedGains[channel] = channelGain;
+		}
+	}
+}
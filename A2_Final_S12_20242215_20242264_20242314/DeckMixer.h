@@ -0,0 +1,85 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerAudio.h"
+#include "DeckRenderPool.h"
+
+// Mixes any number of PlayerAudio decks into the output, each with its own
+// gain and pan, which can be changed from any thread and are smoothed on
+// the audio thread. All decks render into one planar scratch buffer that is
+// allocated in prepareToPlay, then the output is summed channel by channel.
+// Optionally the decks are rendered concurrently on a DeckRenderPool.
+class DeckMixer : private DeckRenderPool::Client
+{
+public:
+	static constexpr int defaultMaxDecks = 32;
+	static constexpr int numBusChannels = 2;
+
+	explicit DeckMixer(int maxDecks = defaultMaxDecks);
+	~DeckMixer() override;
+
+	// Message thread. Decks can be added while audio is running; returns the
+	// deck index, or -1 if the mixer is full.
+	int addDeck(PlayerAudio& deck);
+	int getNumDecks() const { return numDecks.load(std::memory_order_acquire); }
+
+	// Any thread, for deckIndex below getNumDecks()
+	PlayerAudio& getDeck(int deckIndex) const { return *decks[deckIndex].player; }
+	int getMaxDecks() const { return maxDecks; }
+
+	void setDeckGain(int deckIndex, float gain);
+	float getDeckGain(int deckIndex) const;
+
+	// -1.0 = hard left, 0.0 = centre (unity on both sides), 1.0 = hard right
+	void setDeckPan(int deckIndex, float pan);
+	float getDeckPan(int deckIndex) const;
+
+	// Message thread. 0 renders every deck on the audio thread; otherwise decks
+	// are shared between the audio thread and this many worker threads.
+	void setNumRenderThreads(int numThreads);
+
+	// Any thread
+	int getNumRenderThreads() const { return numRenderThreads.load(std::memory_order_relaxed); }
+
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+	void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
+	void releaseResources();
+
+private:
+	struct Deck
+	{
+		PlayerAudio* player = nullptr;
+		std::atomic<float> gain{ 1.0f };
+		std::atomic<float> pan{ 0.0f };
+
+		// Audio thread: the gain each bus channel ended the last chunk on.
+		// A change is ramped across one chunk rather than stepped.
+		float appliedGains[numBusChannels] = {};
+	};
+
+	const int maxDecks;
+	std::unique_ptr<Deck[]> decks;
+	std::atomic<int> numDecks{ 0 };
+
+	// Deck d, bus channel c lives in channel (d * numBusChannels + c)
+	juce::AudioBuffer<float> deckBuffers;
+	int blockSize = 0;
+	double currentSampleRate = 0.0;
+	bool prepared = false;
+
+	// Held by prepareToPlay and releaseResources on the device thread and by
+	// addDeck on the message thread, so a deck added during a device restart
+	// is prepared with the settings that end up in force
+	juce::CriticalSection prepareLock;
+
+	std::unique_ptr<DeckRenderPool> renderPool;
+	juce::SpinLock renderPoolLock;
+	std::atomic<int> numRenderThreads{ 0 };
+	float* const* chunkChannels = nullptr;
+	int chunkSamples = 0;
+
+	void renderJob(int deckIndex) noexcept override;
+	void renderChunk(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, int decksToMix);
+	static void addWithGainRamp(float* dest, const float* source, float startGain, float endGain, int numSamples) noexcept;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckMixer)
+};
@@ -0,0 +1,119 @@
+#include "DeckRenderPool.h"
+#include "AllocationGuard.h"
+
+namespace
+{
+	// How long an idle worker polls for the next batch before parking
+	constexpr int workerSpinIterations = 2000;
+}
+
+DeckRenderPool::DeckRenderPool(int numWorkers)
+{
+	for (int i = 0; i < numWorkers; ++i)
+		workers.add(new Worker(*this, i));
+
+	for (auto* worker : workers)
+		worker->startRealtimeThread(juce::Thread::RealtimeOptions{});
+}
+
+DeckRenderPool::~DeckRenderPool()
+{
+	for (auto* worker : workers)
+		worker->signalThreadShouldExit();
+
+	for (auto* worker : workers)
+		worker->wake();
+
+	workers.clear();
+}
+
+void DeckRenderPool::run(Client& client, int numJobs) noexcept
+{
+	if (numJobs <= 0)
+		return;
+
+	jassert(numJobs <= 0xffff);
+
+	lastGeneration = (lastGeneration + 1) & 0xffff;
+
+	currentClient.store(&client, std::memory_order_relaxed);
+	jobsCompleted.store(0, std::memory_order_relaxed);
+	batchState.store((lastGeneration << 48) | ((juce::uint64)numJobs << 32));
+
+	for (auto* worker : workers)
+		if (worker->parked.load())
+			worker->wake();
+
+	// The audio thread takes jobs too, so the batch completes even if no
+	// worker gets scheduled in time
+	processJobs();
+
+	while (jobsCompleted.load(std::memory_order_acquire) < numJobs)
+	{
+		// Spin: every remaining job is already running on a worker
+	}
+}
+
+void DeckRenderPool::processJobs() noexcept
+{
+	for (;;)
+	{
+		const auto state = batchState.fetch_add(1, std::memory_order_acq_rel);
+		const int job = (int)(state & 0xffffffff);
+		const int numJobs = (int)((state >> 32) & 0xffff);
+
+		if (job >= numJobs)
+			return;
+
+		currentClient.load(std::memory_order_relaxed)->renderJob(job);
+		jobsCompleted.fetch_add(1, std::memory_order_release);
+	}
+}
+
+// ==================== Worker ====================
+
+DeckRenderPool::Worker::Worker(DeckRenderPool& owner, int index)
+	: juce::Thread("Deck Render " + juce::String(index + 1)), pool(owner)
+{
+}
+
+DeckRenderPool::Worker::~Worker()
+{
+	stopThread(1000);
+}
+
+void DeckRenderPool::Worker::wake() noexcept
+{
+	wakeEvent.signal();
+}
+
+void DeckRenderPool::Worker::run()
+{
+	AllocationGuard::ScopedNoAllocation noAllocation;
+
+	auto seenGeneration = generationOf(pool.batchState.load());
+
+	while (!threadShouldExit())
+	{
+		bool hasNewBatch = false;
+
+		for (int i = 0; i < workerSpinIterations && !hasNewBatch; ++i)
+			hasNewBatch = generationOf(pool.batchState.load()) != seenGeneration;
+
+		if (!hasNewBatch)
+		{
+			// Announce that we are about to sleep, then check once more so a
+			// batch published in between is not missed
+			parked.store(true);
+
+			if (generationOf(pool.batchState.load()) == seenGeneration && !threadShouldExit())
+				wakeEvent.wait(10);
+
+			parked.store(false);
+			continue;
+		}
+
+		seenGeneration = generationOf(pool.batchState.load());
+		pool.processJobs();
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <JuceHeader.h>
+
+// A small pool of real-time worker threads used to render decks in parallel.
+// The audio thread publishes a batch of jobs with a few atomic stores, works
+// on the batch itself alongside the workers, and spins until every job has
+// completed. No locks are taken and nothing is allocated per batch.
+class DeckRenderPool
+{
+public:
+	class Client
+	{
+	public:
+		virtual ~Client() = default;
+		virtual void renderJob(int jobIndex) noexcept = 0;
+	};
+
+	explicit DeckRenderPool(int numWorkers);
+	~DeckRenderPool();
+
+	int getNumWorkers() const { return workers.size(); }
+
+	// Audio thread. Calls client.renderJob(0 .. numJobs - 1) spread across the
+	// workers and the calling thread, and returns once all of them are done.
+	void run(Client& client, int numJobs) noexcept;
+
+private:
+	class Worker : public juce::Thread
+	{
+	public:
+		Worker(DeckRenderPool& owner, int index);
+		~Worker() override;
+
+		void run() override;
+		void wake() noexcept;
+
+	private:
+		DeckRenderPool& pool;
+		juce::WaitableEvent wakeEvent;
+		std::atomic<bool> parked{ false };
+
+		friend class DeckRenderPool;
+	};
+
+	juce::OwnedArray<Worker> workers;
+
+	// Packed as [generation:16][numJobs:16][nextJob:32] so that claiming a job
+	// with one fetch_add also yields the size of the batch it belongs to
+	std::atomic<juce::uint64> batchState{ 0 };
+	std::atomic<Client*> currentClient{ nullptr };
+	std::atomic<int> jobsCompleted{ 0 };
+	juce::uint64 lastGeneration = 0;
+
+	static juce::uint64 generationOf(juce::uint64 state) noexcept { return state >> 48; }
+
+	void processJobs() noexcept;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckRenderPool)
+};
@@ -0,0 +1,235 @@
+#include "DeckTrack.h"
+#include "ThumbnailStore.h"
+
+DeckTrack::DeckTrack(const juce::File& fileToPlay, const Settings& settingsToUse, juce::TimeSliceThread& thread)
+	: file(fileToPlay), readAheadThread(thread), settings(settingsToUse)
+{
+}
+
+DeckTrack::~DeckTrack()
+{
+	disconnect();
+}
+
+std::unique_ptr<DeckTrack> DeckTrack::open(const juce::File& file, juce::AudioFormatManager& formats,
+	const Settings& settings, juce::TimeSliceThread& readAheadThread)
+{
+	if (!file.existsAsFile())
+		return nullptr;
+
+	auto* reader = createReaderFor(file, formats, settings.memoryMapping);
+
+	if (reader == nullptr)
+		return nullptr;
+
+	std::unique_ptr<DeckTrack> track(new DeckTrack(file, settings, readAheadThread));
+
+	const auto fileName = file.getFileNameWithoutExtension();
+	track->metadata.title = reader->metadataValues.getValue("title", fileName);
+	track->metadata.artist = reader->metadataValues.getValue("artist", "Unknown Artist");
+	track->metadata.album = reader->metadataValues.getValue("album", "Unknown Album");
+	track->metadata.duration = reader->lengthInSamples / reader->sampleRate;
+
+	track->mappedReader = dynamic_cast<juce::MemoryMappedAudioFormatReader*>(reader);
+	track->readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+	track->readerSource->setLooping(settings.looping);
+	track->stretcher.setSpeed(settings.playbackSpeed);
+	track->stretcher.setQuality(settings.stretchQuality);
+
+	track->thumbnailReader.reset(formats.createReaderFor(file));
+	track->peakReader.reset(formats.createReaderFor(file));
+	track->loopReader.reset(formats.createReaderFor(file));
+
+	if (track->loopReader == nullptr)
+		return nullptr;
+
+	track->thumbnailHash = ThumbnailStore::hashFor(file);
+
+	track->connect(true);
+
+	if (settings.blockSize > 0 && settings.deviceSampleRate > 0.0)
+	{
+		// Pre-decodes the start of the file: the buffering source blocks here
+		// until its first chunk is filled, the mapped path faults in its pages
+		track->prepareToPlay(settings.blockSize, settings.deviceSampleRate);
+
+		if (track->prefetcher != nullptr)
+			track->prefetcher->touchAround(0);
+	}
+
+	return track;
+}
+
+juce::AudioFormatReader* DeckTrack::createReaderFor(const juce::File& file, juce::AudioFormatManager& formats, bool allowMapping)
+{
+	if (allowMapping && file.hasFileExtension("wav;aif;aiff"))
+	{
+		if (auto* format = formats.findFormatForFileExtension(file.getFileExtension()))
+		{
+			std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+
+			if (mapped != nullptr && mapped->mapEntireFile())
+				return mapped.release();
+		}
+	}
+
+	return formats.createReaderFor(file);
+}
+
+void DeckTrack::connect(bool prefill)
+{
+	// Rewiring the transport resets it to the start and stops it, so carry
+	// the play state over
+	const bool wasPlaying = transport.isPlaying();
+	const auto position = loopSource != nullptr ? loopSource->getNextReadPosition()
+		: readerSource->getNextReadPosition();
+
+	disconnect();
+
+	auto* reader = readerSource->getAudioFormatReader();
+	juce::PositionableAudioSource* source = readerSource.get();
+
+	if (mappedReader != nullptr)
+	{
+		// Mapped files are read in place; keep their pages warm instead of buffering
+		prefetcher = std::make_unique<MappedReaderPrefetcher>(*mappedReader,
+			(juce::int64)(settings.prefetchWindowSeconds * reader->sampleRate));
+		prefetcher->setPlayPosition(position);
+		readAheadThread.addTimeSliceClient(prefetcher.get());
+	}
+	else if (settings.readAheadSamples > 0)
+	{
+		readAheadMonitor = std::make_unique<ReadAheadMonitor>(*readerSource);
+		bufferingSource = std::make_unique<juce::BufferingAudioSource>(readAheadMonitor.get(), readAheadThread,
+			false, settings.readAheadSamples, (int)juce::jlimit(1u, 2u, reader->numChannels), prefill);
+		source = bufferingSource.get();
+	}
+
+	loopSource = std::make_unique<LoopSegmentSource>(*source, *loopReader, readAheadThread);
+	loopSource->setLoopRange(loopStartSample, loopEndSample);
+
+	// If the transport is already prepared this also prepares the new chain
+	transport.setSource(loopSource.get(), 0, nullptr, reader->sampleRate);
+	loopSource->setNextReadPosition(position);
+
+	if (wasPlaying)
+		transport.start();
+}
+
+void DeckTrack::disconnect()
+{
+	transport.setSource(nullptr);
+	loopSource.reset();
+	bufferingSource.reset();
+	readAheadMonitor.reset();
+
+	if (prefetcher != nullptr)
+	{
+		readAheadThread.removeTimeSliceClient(prefetcher.get());
+		prefetcher.reset();
+	}
+}
+
+void DeckTrack::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+	preparedBlockSize = samplesPerBlockExpected;
+	preparedSampleRate = sampleRate;
+	transport.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	stretcher.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void DeckTrack::releaseResources()
+{
+	preparedSampleRate = 0.0;
+	stretcher.releaseResources();
+	transport.releaseResources();
+}
+
+bool DeckTrack::isPreparedFor(int samplesPerBlockExpected, double sampleRate) const
+{
+	return preparedBlockSize == samplesPerBlockExpected && preparedSampleRate == sampleRate;
+}
+
+void DeckTrack::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+	stretcher.getNextAudioBlock(bufferToFill);
+
+	if (prefetcher != nullptr)
+		prefetcher->setPlayPosition(readerSource->getNextReadPosition());
+}
+
+bool DeckTrack::isReadAheadBehind(int numSamples) const
+{
+	if (readAheadMonitor == nullptr || !transport.isPlaying() || preparedSampleRate <= 0.0)
+		return false;
+
+	// The buffer is allowed to lag while the loop head plays from memory
+	if (loopSource->isPlayingLoopHead())
+		return false;
+
+	const double sourceRate = getSourceSampleRate() * stretcher.getSpeed();
+	const int sourceSamplesNeeded = (int)std::ceil(numSamples * sourceRate / preparedSampleRate);
+
+	return !readAheadMonitor->isRangeReady(bufferingSource->getNextReadPosition(), sourceSamplesNeeded);
+}
+
+juce::int64 DeckTrack::getSamplesUntilEnd() const
+{
+	const auto unread = juce::jmax<juce::int64>(0, transport.getTotalLength() - transport.getNextReadPosition());
+	return stretcher.getNumBufferedSamples() + (juce::int64)(unread / stretcher.getSpeed());
+}
+
+void DeckTrack::setPosition(double seconds)
+{
+	// Fault the destination in here rather than on the audio thread
+	if (prefetcher != nullptr)
+	{
+		prefetcher->setPlayPosition(secondsToSourceSamples(seconds));
+		prefetcher->touchAround(secondsToSourceSamples(seconds));
+	}
+
+	transport.setPosition(seconds);
+	stretcher.reset();
+}
+
+
+void DeckTrack::setLooping(bool shouldLoop)
+{
+	settings.looping = shouldLoop;
+	readerSource->setLooping(shouldLoop);
+}
+
+void DeckTrack::setLoopRange(double startSeconds, double endSeconds)
+{
+	loopStartSample = secondsToSourceSamples(startSeconds);
+	loopEndSample = secondsToSourceSamples(endSeconds);
+	loopSource->setLoopRange(loopStartSample, loopEndSample);
+
+	if (prefetcher != nullptr)
+	{
+		prefetcher->setLoopRange(secondsToSourceSamples(startSeconds), secondsToSourceSamples(endSeconds));
+		prefetcher->touchAround(secondsToSourceSamples(startSeconds));
+	}
+}
+
+void DeckTrack::clearLoopRange()
+{
+	loopStartSample = 0;
+	loopEndSample = 0;
+	loopSource->clearLoopRange();
+
+	if (prefetcher != nullptr)
+		prefetcher->clearLoopRange();
+}
+
+void DeckTrack::setPlaybackSpeed(double speed)
+{
+	settings.playbackSpeed = speed;
+	stretcher.setSpeed(speed);
+}
+
+void DeckTrack::setStretchQuality(TimeStretcher::Quality quality)
+{
+	settings.stretchQuality = quality;
+	stretcher.setQuality(quality);
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ReadAhead.h"
+#include "TimeStretcher.h"
+#include "LoopSegmentSource.h"
+
+// ==================== SHARED LOADING RESOURCES ====================
+
+// One format manager shared by every deck and loader thread. Creating readers
+// from it concurrently is safe as long as no formats are registered later.
+struct SharedAudioFormats
+{
+	SharedAudioFormats() { manager.registerBasicFormats(); }
+
+	juce::AudioFormatManager manager;
+};
+
+// Background threads that open, probe and pre-buffer files for the decks
+struct TrackLoaderPool
+{
+	juce::ThreadPool pool{ 2 };
+};
+
+// ==================== DECK TRACK ====================
+
+// One loaded file together with the source chain that plays it:
+// reader -> (read-ahead buffer | mapped-page prefetch) -> A-B loop -> transport -> time-stretch.
+// DeckTrack::open builds and primes the whole chain so it can run off the
+// message thread; the deck then only has to swap a pointer to start using it.
+class DeckTrack
+{
+public:
+	struct Settings
+	{
+		bool memoryMapping = true;
+		int readAheadSamples = 0;
+		double prefetchWindowSeconds = 2.0;
+		double playbackSpeed = 1.0;
+		TimeStretcher::Quality stretchQuality = TimeStretcher::Quality::Medium;
+		bool looping = false;
+		int blockSize = 0;
+		double deviceSampleRate = 0.0;
+	};
+
+	struct Metadata
+	{
+		juce::String title;
+		juce::String artist;
+		juce::String album;
+		double duration = 0.0;
+	};
+
+	// Returns nullptr if the file can't be opened. If the settings carry a
+	// device configuration the chain is also prepared, which fills the start
+	// of the read-ahead buffer before returning.
+	static std::unique_ptr<DeckTrack> open(const juce::File& file, juce::AudioFormatManager& formats,
+		const Settings& settings, juce::TimeSliceThread& readAheadThread);
+
+	~DeckTrack();
+
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+	void releaseResources();
+	bool isPreparedFor(int samplesPerBlockExpected, double sampleRate) const;
+
+	// Audio thread
+	void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
+	bool isReadAheadBehind(int numSamples) const;
+
+	// Audio thread: high-resolution ticks spent in the transport (decoding
+	// and sample rate conversion) since the last call
+	juce::int64 takeSourceTicks() noexcept { return std::exchange(timedTransport.ticks, 0); }
+
+	// Output samples until the end of the file, including audio that is
+	// still buffered in the time-stretcher
+	juce::int64 getSamplesUntilEnd() const;
+
+	void setPosition(double seconds);
+	void setLooping(bool shouldLoop);
+	void setLoopRange(double startSeconds, double endSeconds);
+	void clearLoopRange();
+	void setPlaybackSpeed(double speed);
+	void setStretchQuality(TimeStretcher::Quality quality);
+
+	bool isMemoryMapped() const { return mappedReader != nullptr; }
+	double getSourceSampleRate() const { return readerSource->getAudioFormatReader()->sampleRate; }
+	juce::int64 secondsToSourceSamples(double seconds) const { return (juce::int64)(seconds * getSourceSampleRate()); }
+
+	// A separate stream reader for the waveform thumbnail, opened together with
+	// the track so the deck doesn't have to touch the file on the message thread
+	std::unique_ptr<juce::AudioFormatReader> thumbnailReader;
+	juce::int64 thumbnailHash = 0;
+
+	// Likewise for the deck's zoomable peak pyramid
+	std::unique_ptr<juce::AudioFormatReader> peakReader;
+
+	juce::File file;
+	Metadata metadata;
+	juce::AudioTransportSource transport;
+
+private:
+	// Passes the transport through, timing each block it renders
+	struct TimedSource : public juce::AudioSource
+	{
+		explicit TimedSource(juce::AudioSource& sourceToTime) : source(sourceToTime) {}
+
+		void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override { source.prepareToPlay(samplesPerBlockExpected, sampleRate); }
+		void releaseResources() override { source.releaseResources(); }
+
+		void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+		{
+			const auto startTicks = juce::Time::getHighResolutionTicks();
+			source.getNextAudioBlock(bufferToFill);
+			ticks += juce::Time::getHighResolutionTicks() - startTicks;
+		}
+
+		juce::AudioSource& source;
+		juce::int64 ticks = 0;
+	};
+
+	TimedSource timedTransport{ transport };
+
+	// Changes speed after the transport so the resampler never has to be
+	// rebuilt and the pitch stays put
+	TimeStretcher stretcher{ timedTransport };
+
+	DeckTrack(const juce::File& file, const Settings& settings, juce::TimeSliceThread& readAheadThread);
+
+	juce::TimeSliceThread& readAheadThread;
+	Settings settings;
+
+	std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+	juce::MemoryMappedAudioFormatReader* mappedReader = nullptr; // owned by readerSource
+	std::unique_ptr<ReadAheadMonitor> readAheadMonitor;
+	std::unique_ptr<juce::BufferingAudioSource> bufferingSource;
+	std::unique_ptr<LoopSegmentSource> loopSource;
+	std::unique_ptr<juce::AudioFormatReader> loopReader;
+
+	juce::int64 loopStartSample = 0;
+	juce::int64 loopEndSample = 0;
+	std::unique_ptr<MappedReaderPrefetcher> prefetcher;
+
+	int preparedBlockSize = 0;
+	double preparedSampleRate = 0.0;
+
+	static juce::AudioFormatReader* createReaderFor(const juce::File& file, juce::AudioFormatManager& formats, bool allowMapping);
+	void connect(bool prefill);
+	void disconnect();
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckTrack)
+};
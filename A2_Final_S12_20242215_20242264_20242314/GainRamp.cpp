@@ -0,0 +1,101 @@
+#include "GainRamp.h"
+
+namespace
+{
+	// Exponential fades start from about -60 dB
+	constexpr float exponentialSteepness = 6.9f;
+
+	float curveGain(GainRamp::Curve curve, float x)
+	{
+		switch (curve)
+		{
+		case GainRamp::Curve::EqualPower:  return std::sin(x * juce::MathConstants<float>::halfPi);
+		case GainRamp::Curve::Exponential: return (std::exp(exponentialSteepness * x) - 1.0f) / (std::exp(exponentialSteepness) - 1.0f);
+		case GainRamp::Curve::Linear:
+		default:                           return x;
+		}
+	}
+}
+
+void GainRamp::prepare(double sampleRate, double lengthMs, Curve curve)
+{
+	length = juce::jmax(1, juce::roundToInt(sampleRate * lengthMs / 1000.0));
+
+	fadeInGains.allocate((size_t)length, false);
+	fadeOutGains.allocate((size_t)length, false);
+
+	for (int i = 0; i < length; ++i)
+	{
+		const float gain = curveGain(curve, (float)(i + 1) / (float)length);
+		fadeInGains[i] = gain;
+		fadeOutGains[length - 1 - i] = gain;
+	}
+
+	position = 0;
+	state = State::Unity;
+}
+
+void GainRamp::fadeIn() noexcept
+{
+	if (state == State::FadingOut)
+		position = length - position;
+	else if (state == State::Silent)
+		position = 0;
+	else
+		return;
+
+	state = State::FadingIn;
+}
+
+void GainRamp::fadeInFromSilence() noexcept
+{
+	state = State::Silent;
+	fadeIn();
+}
+
+void GainRamp::fadeOut() noexcept
+{
+	if (state == State::FadingIn)
+		position = length - position;
+	else if (state == State::Unity)
+		position = 0;
+	else
+		return;
+
+	state = State::FadingOut;
+}
+
+void GainRamp::process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+{
+	if (state == State::Unity)
+		return;
+
+	if (state == State::Silent || length == 0)
+	{
+		bufferToFill.clearActiveBufferRegion();
+		return;
+	}
+
+	const int numToFade = juce::jmin(bufferToFill.numSamples, length - position);
+	const float* gains = (state == State::FadingIn ? fadeInGains : fadeOutGains) + position;
+
+	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+		juce::FloatVectorOperations::multiply(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample), gains, numToFade);
+
+	position += numToFade;
+
+	if (position < length)
+		return;
+
+	if (state == State::FadingIn)
+	{
+		state = State::Unity;
+		return;
+	}
+
+	state = State::Silent;
+
+	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+		juce::FloatVectorOperations::clear(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + numToFade),
+			bufferToFill.numSamples - numToFade);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Fades a deck's output in and out. The gain curve is computed once per
+// device configuration, so a fade costs one vector multiply per channel.
+// Once faded out the ramp holds silence until it is told to fade back in.
+// Reversing direction part-way through picks up from the current gain.
+class GainRamp
+{
+public:
+	enum class Curve { Linear, EqualPower, Exponential };
+
+	// Allocates; call before playback starts
+	void prepare(double sampleRate, double lengthMs, Curve curve);
+
+	// Audio thread
+	void fadeIn() noexcept;
+	void fadeInFromSilence() noexcept;
+	void fadeOut() noexcept;
+	void setUnity() noexcept { state = State::Unity; }
+
+	bool isSilent() const noexcept { return state == State::Silent; }
+	void process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept;
+
+private:
+	enum class State { Unity, FadingIn, FadingOut, Silent };
+
+	juce::HeapBlock<float> fadeInGains;
+	juce::HeapBlock<float> fadeOutGains;
+	int length = 0;
+	int position = 0;
+	State state = State::Unity;
+};
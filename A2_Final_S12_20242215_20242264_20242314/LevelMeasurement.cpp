@@ -0,0 +1,119 @@
+#include "LevelMeasurement.h"
+
+void LevelMeasurement::prepare(double newSampleRate, int samplesPerBlockExpected)
+{
+	sampleRate = newSampleRate;
+	blockSize = juce::jmax(1, samplesPerBlockExpected);
+
+	history.setSize(maxChannels, numTaps - 1 + blockSize);
+	history.clear();
+	interpolated.allocate((size_t)blockSize, false);
+
+	// Hann-windowed sinc, centred between taps 5 and 6, each phase
+	// normalised so it passes DC at unity
+	for (int phase = 0; phase < numPhases; ++phase)
+	{
+		const double offset = (phase + 1) / (double)(numPhases + 1);
+		double sum = 0.0;
+
+		for (int tap = 0; tap < numTaps; ++tap)
+		{
+			const double x = tap - (numTaps / 2 - 1) - offset;
+			const double sinc = juce::MathConstants<double>::pi * x;
+			const double window = 0.5 + 0.5 * std::cos(juce::MathConstants<double>::pi * x / (numTaps / 2 + 0.5));
+			const double coefficient = std::sin(sinc) / sinc * window;
+
+			phaseCoefficients[phase][tap] = (float)coefficient;
+			sum += coefficient;
+		}
+
+		for (auto& coefficient : phaseCoefficients[phase])
+			coefficient = (float)(coefficient / sum);
+	}
+
+	for (int channel = 0; channel < maxChannels; ++channel)
+	{
+		meanSquares[channel] = 0.0f;
+		levels[channel].peak.store(0.0f);
+		levels[channel].rms.store(0.0f);
+		levels[channel].truePeak.store(0.0f);
+	}
+}
+
+void LevelMeasurement::process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+{
+	const int channelsToMeasure = juce::jmin(bufferToFill.buffer->getNumChannels(), maxChannels);
+	numChannels.store(channelsToMeasure, std::memory_order_relaxed);
+
+	if (blockSize == 0)
+		return;
+
+	for (int channel = 0; channel < channelsToMeasure; ++channel)
+	{
+		const float* data = bufferToFill.buffer->getReadPointer(channel, bufferToFill.startSample);
+
+		// Larger blocks than prepared for are measured in chunks
+		for (int offset = 0; offset < bufferToFill.numSamples; offset += blockSize)
+			processChunk(channel, data + offset, juce::jmin(blockSize, bufferToFill.numSamples - offset));
+	}
+}
+
+void LevelMeasurement::processChunk(int channel, const float* data, int numSamples) noexcept
+{
+	auto& channelLevels = levels[channel];
+
+	const auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+	const float peak = juce::jmax(-range.getStart(), range.getEnd());
+	publishMaximum(channelLevels.peak, peak);
+
+	float sumOfSquares = 0.0f;
+
+	for (int i = 0; i < numSamples; ++i)
+		sumOfSquares += data[i] * data[i];
+
+	// One-pole average of the blocks' mean squares, with the time constant
+	// of the RMS window whatever the block size
+	const float coefficient = 1.0f - (float)std::exp(-numSamples / (rmsWindowSeconds * sampleRate));
+	meanSquares[channel] += (sumOfSquares / (float)numSamples - meanSquares[channel]) * coefficient;
+	channelLevels.rms.store(std::sqrt(meanSquares[channel]), std::memory_order_relaxed);
+
+	// Each phase of the interpolator is a sum of shifted copies of the
+	// signal, so it's built with one vector multiply-add per tap
+	float* line = history.getWritePointer(channel);
+	juce::FloatVectorOperations::copy(line + numTaps - 1, data, numSamples);
+
+	float truePeak = peak;
+
+	for (const auto& coefficients : phaseCoefficients)
+	{
+		juce::FloatVectorOperations::multiply(interpolated.get(), line, coefficients[0], numSamples);
+
+		for (int tap = 1; tap < numTaps; ++tap)
+			juce::FloatVectorOperations::addWithMultiply(interpolated.get(), line + tap, coefficients[tap], numSamples);
+
+		const auto phaseRange = juce::FloatVectorOperations::findMinAndMax(interpolated.get(), numSamples);
+		truePeak = juce::jmax(truePeak, -phaseRange.getStart(), phaseRange.getEnd());
+	}
+
+	publishMaximum(channelLevels.truePeak, truePeak);
+	std::memmove(line, line + numSamples, sizeof(float) * (numTaps - 1));
+}
+
+void LevelMeasurement::publishMaximum(std::atomic<float>& level, float value) noexcept
+{
+	// Only the audio thread raises the value, so a plain compare is enough.
+	// At worst a reset that lands in between loses one block's peak.
+	if (value > level.load(std::memory_order_relaxed))
+		level.store(value, std::memory_order_relaxed);
+}
+
+LevelMeasurement::Levels LevelMeasurement::takeLevels(int channel) noexcept
+{
+	auto& channelLevels = levels[channel];
+
+	Levels result;
+	result.peak = channelLevels.peak.exchange(0.0f, std::memory_order_relaxed);
+	result.rms = channelLevels.rms.load(std::memory_order_relaxed);
+	result.truePeak = channelLevels.truePeak.exchange(0.0f, std::memory_order_relaxed);
+	return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== LEVEL MEASUREMENT ====================
+
+// Measures a signal's levels where it is rendered and publishes them in
+// atomics, for a LevelMeter on the message thread to pick up. Nothing is
+// shared but the numbers, so the meter never touches an audio buffer.
+//
+// Per channel, in linear gain:
+//  - peak: the largest sample since the meter last read it
+//  - RMS: over roughly the last 300 ms
+//  - true peak: the largest value between the samples as well, found by
+//    4x oversampling as ITU-R BS.1770 describes, since the last read
+class LevelMeasurement
+{
+public:
+	static constexpr int maxChannels = 2;
+	static constexpr double rmsWindowSeconds = 0.3;
+
+	// Allocates; call before playback starts
+	void prepare(double sampleRate, int samplesPerBlockExpected);
+
+	// Audio thread
+	void process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept;
+
+	struct Levels
+	{
+		float peak = 0.0f;
+		float rms = 0.0f;
+		float truePeak = 0.0f;
+	};
+
+	// Message thread, one reader only. Starts the next peak and true peak over.
+	Levels takeLevels(int channel) noexcept;
+	int getNumChannels() const noexcept { return numChannels.load(std::memory_order_relaxed); }
+
+private:
+	// The interpolation filter, one 12-tap phase for each point between two
+	// samples. The fourth phase lands on the sample itself, which is the peak.
+	static constexpr int numTaps = 12;
+	static constexpr int numPhases = 3;
+	float phaseCoefficients[numPhases][numTaps] = {};
+
+	struct ChannelLevels
+	{
+		std::atomic<float> peak{ 0.0f };
+		std::atomic<float> rms{ 0.0f };
+		std::atomic<float> truePeak{ 0.0f };
+	};
+
+	ChannelLevels levels[maxChannels];
+	std::atomic<int> numChannels{ 0 };
+
+	// Audio thread. history holds the last numTaps - 1 samples of each
+	// channel followed by the current chunk.
+	juce::AudioBuffer<float> history;
+	juce::HeapBlock<float> interpolated;
+	float meanSquares[maxChannels] = {};
+	double sampleRate = 0.0;
+	int blockSize = 0;
+
+	void processChunk(int channel, const float* data, int numSamples) noexcept;
+	static void publishMaximum(std::atomic<float>& level, float value) noexcept;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeasurement)
+};
@@ -0,0 +1,159 @@
+#include "LevelMeter.h"
+
+namespace
+{
+	constexpr double peakHoldSeconds = 1.5;
+	constexpr float peakFallDecibelsPerSecond = 20.0f;
+}
+
+LevelMeter::LevelMeter(LevelMeasurement& measurementToShow)
+	: measurement(measurementToShow)
+{
+	ThemeManager::getInstance().addListener(this);
+	setOpaque(true);
+
+	lastTickSeconds = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+	startTimerHz(30);
+}
+
+LevelMeter::~LevelMeter()
+{
+	ThemeManager::getInstance().removeListener(this);
+}
+
+bool LevelMeter::Positions::operator==(const Positions& other) const
+{
+	if (numChannels != other.numChannels)
+		return false;
+
+	for (int c = 0; c < numChannels; ++c)
+		if (rms[c] != other.rms[c] || peak[c] != other.peak[c] || over[c] != other.over[c])
+			return false;
+
+	return true;
+}
+
+void LevelMeter::timerCallback()
+{
+	const double now = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+	const float elapsed = (float)(now - lastTickSeconds);
+	lastTickSeconds = now;
+
+	for (int c = 0; c < measurement.getNumChannels(); ++c)
+	{
+		const auto levels = measurement.takeLevels(c);
+		auto& channel = channels[c];
+
+		channel.rmsDecibels = juce::Decibels::gainToDecibels(levels.rms, minimumDecibels);
+
+		const float peakDecibels = juce::Decibels::gainToDecibels(levels.peak, minimumDecibels);
+
+		if (peakDecibels >= channel.peakDecibels)
+		{
+			channel.peakDecibels = peakDecibels;
+			channel.peakHeldUntil = now + peakHoldSeconds;
+		}
+		else if (now > channel.peakHeldUntil)
+		{
+			channel.peakDecibels = juce::jmax(peakDecibels, channel.peakDecibels - peakFallDecibelsPerSecond * elapsed);
+		}
+
+		channel.over = channel.over || levels.truePeak > 1.0f;
+	}
+
+	if (!(getPositions() == painted))
+		repaint();
+}
+
+void LevelMeter::mouseDown(const juce::MouseEvent&)
+{
+	for (auto& channel : channels)
+		channel.over = false;
+
+	repaint();
+}
+
+void LevelMeter::resized()
+{
+	// Forces the next tick to repaint at the new size
+	painted = {};
+}
+
+int LevelMeter::getBarLength() const
+{
+	return juce::jmax(0, (isHorizontal() ? getWidth() : getHeight()) - 2);
+}
+
+int LevelMeter::toPosition(float decibels) const
+{
+	const float proportion = (juce::jlimit(minimumDecibels, maximumDecibels, decibels) - minimumDecibels)
+		/ (maximumDecibels - minimumDecibels);
+
+	return juce::roundToInt(proportion * (float)getBarLength());
+}
+
+LevelMeter::Positions LevelMeter::getPositions() const
+{
+	Positions positions;
+	positions.numChannels = measurement.getNumChannels();
+
+	for (int c = 0; c < positions.numChannels; ++c)
+	{
+		positions.rms[c] = toPosition(channels[c].rmsDecibels);
+		positions.peak[c] = toPosition(channels[c].peakDecibels);
+		positions.over[c] = channels[c].over;
+	}
+
+	return positions;
+}
+
+void LevelMeter::paint(juce::Graphics& g)
+{
+	auto& colors = ThemeManager::getInstance().getColors();
+	painted = getPositions();
+
+	g.fillAll(colors.secondaryBackground);
+
+	const auto bounds = getLocalBounds().reduced(1);
+	const bool horizontal = isHorizontal();
+	const int numChannels = juce::jmax(1, painted.numChannels);
+	const int thickness = (horizontal ? bounds.getHeight() : bounds.getWidth()) / numChannels;
+
+	// Bar c's area from 0 to position along it
+	auto barArea = [&](int c, int position)
+		{
+			return horizontal
+				? juce::Rectangle<int>(bounds.getX(), bounds.getY() + c * thickness, position, thickness - 1)
+				: juce::Rectangle<int>(bounds.getX() + c * thickness, bounds.getBottom() - position, thickness - 1, position);
+		};
+
+	for (int c = 0; c < painted.numChannels; ++c)
+	{
+		g.setColour(colors.waveform);
+		g.fillRect(barArea(c, painted.rms[c]));
+
+		// The peak as a 2-pixel line at the end of its span
+		auto peakArea = barArea(c, painted.peak[c]);
+		g.setColour(colors.text);
+		g.fillRect(horizontal ? peakArea.removeFromRight(2) : peakArea.removeFromTop(2));
+
+		if (painted.over[c])
+		{
+			auto tip = barArea(c, getBarLength());
+			g.setColour(colors.stopButton);
+			g.fillRect(horizontal ? tip.removeFromRight(4) : tip.removeFromTop(4));
+		}
+	}
+
+	// 0 dBFS
+	const int zero = toPosition(0.0f);
+	g.setColour(colors.textSecondary);
+
+	if (horizontal)
+		g.drawVerticalLine(bounds.getX() + zero, (float)bounds.getY(), (float)bounds.getBottom());
+	else
+		g.drawHorizontalLine(bounds.getBottom() - zero, (float)bounds.getX(), (float)bounds.getRight());
+
+	g.setColour(colors.border);
+	g.drawRect(getLocalBounds(), 1);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <JuceHeader.h>
+#include "LevelMeasurement.h"
+#include "PlayerAudio.h"
+
+// ==================== LEVEL METER ====================
+
+// Shows a LevelMeasurement as one bar per channel: RMS as the filled bar,
+// the peak as a line that holds for a moment before falling, and a red tip
+// once the true peak has gone over 0 dBFS. Laid out across when wider than
+// tall, otherwise upwards.
+//
+// The timer reads the levels and works out where everything would be drawn.
+// Only when that differs from the last paint does the meter repaint, so a
+// silent or steady meter costs no painting at all.
+class LevelMeter : public juce::Component,
+	private juce::Timer,
+	public ThemeManager::Listener
+{
+public:
+	explicit LevelMeter(LevelMeasurement& measurementToShow);
+	~LevelMeter() override;
+
+	void paint(juce::Graphics& g) override;
+	void resized() override;
+	void themeChanged() override { repaint(); }
+
+	// Clears the held over indicator
+	void mouseDown(const juce::MouseEvent&) override;
+
+	static constexpr float minimumDecibels = -60.0f;
+	static constexpr float maximumDecibels = 6.0f;
+
+private:
+	LevelMeasurement& measurement;
+
+	struct ChannelState
+	{
+		float rmsDecibels = minimumDecibels;
+		float peakDecibels = minimumDecibels;
+		double peakHeldUntil = 0.0;
+		bool over = false;
+	};
+
+	// Where each part of a bar ends, in pixels along it
+	struct Positions
+	{
+		int numChannels = 0;
+		int rms[LevelMeasurement::maxChannels] = {};
+		int peak[LevelMeasurement::maxChannels] = {};
+		bool over[LevelMeasurement::maxChannels] = {};
+
+		bool operator==(const Positions& other) const;
+	};
+
+	ChannelState channels[LevelMeasurement::maxChannels];
+	Positions painted;
+	double lastTickSeconds = 0.0;
+
+	void timerCallback() override;
+	Positions getPositions() const;
+	int getBarLength() const;
+	bool isHorizontal() const { return getWidth() > getHeight(); }
+	int toPosition(float decibels) const;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeter)
+};
@@ -0,0 +1,108 @@
+#include "LibraryIndex.h"
+
+LibraryIndex::LibraryIndex(const juce::File& fileToUse)
+	: indexFile(fileToUse)
+{
+}
+
+juce::File LibraryIndex::getDefaultFile()
+{
+	return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+		.getChildFile("Audio Player Pro").getChildFile("library.idx");
+}
+
+void LibraryIndex::Entry::setDuration(double seconds)
+{
+	duration = seconds;
+
+	const int mins = (int)seconds / 60;
+	const int secs = (int)seconds % 60;
+	durationText = juce::String(mins) + ":" + juce::String(secs).paddedLeft('0', 2);
+}
+
+std::vector<LibraryIndex::Entry> LibraryIndex::load() const
+{
+	std::vector<Entry> entries;
+
+	if (!indexFile.existsAsFile())
+		return entries;
+
+	juce::MemoryMappedFile mapped(indexFile, juce::MemoryMappedFile::readOnly);
+
+	if (mapped.getData() == nullptr)
+		return entries;
+
+	juce::MemoryInputStream in(mapped.getData(), mapped.getSize(), false);
+
+	if (in.readInt() != magic || in.readInt() != formatVersion)
+		return entries;
+
+	const int numEntries = in.readInt();
+
+	// Three empty strings and five numbers at the very least
+	constexpr juce::int64 smallestEntryBytes = 3 + 5 * 8;
+
+	if (numEntries <= 0 || numEntries > in.getNumBytesRemaining() / smallestEntryBytes)
+		return entries;
+
+	entries.reserve((size_t)numEntries);
+
+	for (int i = 0; i < numEntries; ++i)
+	{
+		Entry entry;
+		entry.file = juce::File(in.readString());
+		entry.title = in.readString();
+		entry.artist = in.readString();
+		entry.setDuration(in.readDouble());
+		entry.sampleRate = in.readDouble();
+		entry.size = in.readInt64();
+		entry.modified = in.readInt64();
+		entry.thumbnailKey = in.readInt64();
+		entries.push_back(std::move(entry));
+	}
+
+	// A file that was cut short doesn't end with its marker
+	if (in.readInt() != magic)
+		return {};
+
+	return entries;
+}
+
+bool LibraryIndex::save(const std::vector<Entry>& entries) const
+{
+	indexFile.getParentDirectory().createDirectory();
+
+	// Written next to the index and moved over it, so a crash can't leave half a file
+	juce::TemporaryFile temp(indexFile);
+
+	{
+		juce::FileOutputStream out(temp.getFile());
+
+		if (out.failedToOpen())
+			return false;
+
+		out.writeInt(magic);
+		out.writeInt(formatVersion);
+		out.writeInt((int)entries.size());
+
+		for (const auto& entry : entries)
+		{
+			out.writeString(entry.file.getFullPathName());
+			out.writeString(entry.title);
+			out.writeString(entry.artist);
+			out.writeDouble(entry.duration);
+			out.writeDouble(entry.sampleRate);
+			out.writeInt64(entry.size);
+			out.writeInt64(entry.modified);
+			out.writeInt64(entry.thumbnailKey);
+		}
+
+		out.writeInt(magic);
+		out.flush();
+
+		if (out.getStatus().failed())
+			return false;
+	}
+
+	return temp.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== LIBRARY INDEX ====================
+
+// The playlist as last seen, saved to a compact binary file in the user's
+// application data folder. Each entry remembers the size and modification
+// time its metadata was read at, so a rescan only has to reopen files whose
+// size or time has changed.
+class LibraryIndex
+{
+public:
+	struct Entry
+	{
+		juce::File file;
+		juce::String title;
+		juce::String artist;
+		double duration = 0.0;
+		double sampleRate = 0.0;
+
+		// duration as m:ss, kept for the playlist to draw. Not saved.
+		juce::String durationText;
+
+		// -1 until the file has been looked at
+		juce::int64 size = -1;
+		juce::int64 modified = 0;
+
+		// The file's key in the ThumbnailStore, which the playlist prepares
+		// it under without another stat
+		juce::int64 thumbnailKey = 0;
+
+		// Sets duration and durationText together
+		void setDuration(double seconds);
+
+		// True if the file's size and modification time still match
+		bool isCurrent(juce::int64 fileSize, juce::int64 fileModified) const noexcept { return size == fileSize && modified == fileModified; }
+	};
+
+	explicit LibraryIndex(const juce::File& fileToUse = getDefaultFile());
+
+	// Returns nothing if the index is missing, from another version or damaged
+	std::vector<Entry> load() const;
+	bool save(const std::vector<Entry>& entries) const;
+
+	static juce::File getDefaultFile();
+
+private:
+	static constexpr int magic = 0x494c5041; // "APLI"
+	static constexpr int formatVersion = 1;
+
+	juce::File indexFile;
+};
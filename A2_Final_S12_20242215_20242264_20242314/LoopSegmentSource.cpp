@@ -0,0 +1,300 @@
+#include "LoopSegmentSource.h"
+
+LoopSegmentSource::LoopSegmentSource(juce::PositionableAudioSource& sourceToLoop, juce::AudioFormatReader& headReader,
+	juce::TimeSliceThread& readAheadThread)
+	: source(sourceToLoop), reader(headReader), thread(readAheadThread),
+	headLength(juce::jmax(1, juce::roundToInt(headReader.sampleRate * headSeconds))),
+	seamLength(juce::jmax(1, juce::roundToInt(headReader.sampleRate * seamSeconds)))
+{
+	seamFadeIn.allocate((size_t)seamLength, false);
+
+	for (int i = 0; i < seamLength; ++i)
+		seamFadeIn[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::pi * ((float)i + 0.5f) / (float)seamLength);
+
+	seamPos = seamLength;
+	thread.addTimeSliceClient(this);
+}
+
+LoopSegmentSource::~LoopSegmentSource()
+{
+	thread.removeTimeSliceClient(this);
+}
+
+void LoopSegmentSource::setLoopRange(juce::int64 startSample, juce::int64 endSample)
+{
+	{
+		const juce::SpinLock::ScopedLockType lock(requestLock);
+		requestedStart = startSample;
+		requestedEnd = endSample;
+		++requestSerial;
+	}
+
+	thread.moveToFrontOfQueue(this);
+}
+
+bool LoopSegmentSource::isLoopHeadReady() const noexcept
+{
+	const juce::SpinLock::ScopedLockType lock(requestLock);
+	return publishedSerial.load() == requestSerial;
+}
+
+void LoopSegmentSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+	source.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void LoopSegmentSource::releaseResources()
+{
+	source.releaseResources();
+}
+
+void LoopSegmentSource::setNextReadPosition(juce::int64 newPosition)
+{
+	// The audio thread drops out of the loop head when it sees the request
+	source.setNextReadPosition(newPosition);
+	seekRequest.store(newPosition);
+}
+
+juce::int64 LoopSegmentSource::getNextReadPosition() const
+{
+	const auto seek = seekRequest.load();
+
+	if (seek >= 0)
+		return seek;
+
+	const auto fromHead = headPosition.load(std::memory_order_relaxed);
+	return fromHead >= 0 ? fromHead : source.getNextReadPosition();
+}
+
+void LoopSegmentSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+	if (seekRequest.exchange(-1) >= 0)
+	{
+		readingHead = false;
+		seamPos = seamLength;
+	}
+
+	// A newly decoded range takes over once the head in front has finished
+	// playing, seam included, so a loop moved mid-wrap never seeks
+	if (!readingHead && seamPos >= seamLength && (middleHead.load() & freshHead) != 0)
+		frontHead = middleHead.exchange(frontHead) & headIndexMask;
+
+	const Head& loopHead = heads[frontHead];
+	const bool looping = loopHead.start < loopHead.end;
+
+	auto position = readingHead ? loopHead.start + headReadPos : source.getNextReadPosition();
+	int done = 0;
+
+	while (done < bufferToFill.numSamples)
+	{
+		if (looping && position >= loopHead.end)
+		{
+			readingHead = true;
+			headReadPos = 0;
+			seamPos = 0;
+
+			// The file source refills from the end of the head while the head
+			// plays from memory
+			source.setNextReadPosition(loopHead.start + loopHead.numSamples);
+			position = loopHead.start;
+		}
+
+		int numSamples = bufferToFill.numSamples - done;
+
+		if (looping)
+			numSamples = (int)juce::jmin<juce::int64>(numSamples, loopHead.end - position);
+
+		if (readingHead)
+		{
+			numSamples = juce::jmin(numSamples, loopHead.numSamples - headReadPos);
+
+			for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+				juce::FloatVectorOperations::copy(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + done),
+					loopHead.samples.getReadPointer(juce::jmin(channel, loopHead.samples.getNumChannels() - 1), headReadPos),
+					numSamples);
+
+			headReadPos += numSamples;
+
+			// The file source is already waiting at the end of the head
+			if (headReadPos == loopHead.numSamples)
+				readingHead = false;
+		}
+		else
+		{
+			source.getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + done, numSamples));
+		}
+
+		if (seamPos < seamLength)
+			applySeam(bufferToFill, done, numSamples, loopHead);
+
+		position += numSamples;
+		done += numSamples;
+	}
+
+	headPosition.store(readingHead ? position : -1, std::memory_order_relaxed);
+}
+
+void LoopSegmentSource::applySeam(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, const Head& loopHead) noexcept
+{
+	const int numToFade = juce::jmin(numSamples, seamLength - seamPos);
+
+	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+	{
+		auto* out = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + offset);
+		const auto* tail = loopHead.tail.getReadPointer(juce::jmin(channel, loopHead.tail.getNumChannels() - 1), seamPos);
+
+		for (int i = 0; i < numToFade; ++i)
+		{
+			const float fadeIn = seamFadeIn[seamPos + i];
+			out[i] = out[i] * fadeIn + tail[i] * (1.0f - fadeIn);
+		}
+	}
+
+	seamPos += numToFade;
+}
+
+int LoopSegmentSource::useTimeSlice()
+{
+	juce::int64 start, end;
+
+	{
+		const juce::SpinLock::ScopedLockType lock(requestLock);
+
+		if (requestSerial == filledSerial)
+			return 50;
+
+		filledSerial = requestSerial;
+		start = requestedStart;
+		end = requestedEnd;
+	}
+
+	auto& back = heads[backHead];
+	back.start = start;
+	back.end = end;
+	back.numSamples = 0;
+
+	if (start < end)
+	{
+		back.numSamples = (int)juce::jmin<juce::int64>(headLength, end - start);
+		back.samples.setSize(2, back.numSamples, false, false, true);
+		back.tail.setSize(2, seamLength, false, false, true);
+
+		reader.read(&back.samples, 0, back.numSamples, start, true, true);
+		reader.read(&back.tail, 0, seamLength, end, true, true);
+	}
+
+	backHead = middleHead.exchange(backHead | freshHead) & headIndexMask;
+	publishedSerial.store(filledSerial);
+
+	// Another request may have come in while this one was decoding
+	return 0;
+}
+
+// ============================== Boundary test ==============================
+
+namespace
+{
+	constexpr double testSampleRate = 44100.0;
+
+	// Every sample holds its own position in the file, on both channels
+	class RampReader : public juce::AudioFormatReader
+	{
+	public:
+		RampReader()
+			: juce::AudioFormatReader(nullptr, "Ramp")
+		{
+			sampleRate = testSampleRate;
+			bitsPerSample = 32;
+			lengthInSamples = 1 << 23;
+			numChannels = 2;
+			usesFloatingPointData = true;
+		}
+
+		bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+			juce::int64 startSampleInFile, int numSamples) override
+		{
+			for (int channel = 0; channel < numDestChannels; ++channel)
+				if (auto* dest = reinterpret_cast<float*>(destChannels[channel]))
+					for (int i = 0; i < numSamples; ++i)
+						dest[startOffsetInDestBuffer + i] = (float)(startSampleInFile + i);
+
+			return true;
+		}
+	};
+}
+
+bool runLoopBoundaryTest(juce::String& result)
+{
+	bool passed = true;
+	result << "A-B loop boundary error, ramp source at " << juce::String(testSampleRate / 1000.0, 1) << " kHz\n";
+
+	juce::TimeSliceThread thread("Loop boundary test");
+	thread.startThread();
+
+	const juce::int64 loopStart = 30000;
+	const int seamLength = juce::jmax(1, juce::roundToInt(testSampleRate * LoopSegmentSource::seamSeconds));
+
+	for (const juce::int64 loopLength : { 1000, 7777, 40000 })
+	{
+		for (const int blockSize : { 64, 480, 512, 4096 })
+		{
+			juce::AudioFormatReaderSource rampSource(new RampReader(), true);
+			RampReader headReader;
+			LoopSegmentSource loop(rampSource, headReader, thread);
+
+			const auto loopEnd = loopStart + loopLength;
+			juce::int64 expected = loopStart - 1000;
+
+			loop.prepareToPlay(blockSize, testSampleRate);
+			loop.setNextReadPosition(expected);
+			loop.setLoopRange(loopStart, loopEnd);
+
+			for (int waitedMs = 0; !loop.isLoopHeadReady() && waitedMs < 2000; ++waitedMs)
+				juce::Thread::sleep(1);
+
+			juce::AudioBuffer<float> buffer(2, blockSize);
+			int samplesSinceWrap = seamLength;
+			int numWraps = 0;
+			double maxError = 0.0;
+
+			for (int block = 0; block < (int)(10.0 * testSampleRate) / blockSize; ++block)
+			{
+				loop.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, blockSize));
+
+				for (int i = 0; i < blockSize; ++i)
+				{
+					if (expected >= loopEnd)
+					{
+						expected = loopStart;
+						samplesSinceWrap = 0;
+						++numWraps;
+					}
+
+					// The seam crossfades from the audio after B, so only the
+					// samples past it are compared
+					if (samplesSinceWrap >= seamLength)
+						for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+							maxError = juce::jmax(maxError, std::abs((double)buffer.getSample(channel, i) - (double)expected));
+
+					++expected;
+					++samplesSinceWrap;
+				}
+			}
+
+			loop.releaseResources();
+
+			// A loop that never wrapped proves nothing either
+			const bool casePassed = maxError == 0.0 && numWraps > 0;
+			jassert(casePassed);
+			passed = passed && casePassed;
+
+			result << "loop " << (int)loopLength << ", " << blockSize << "-sample blocks: "
+				<< numWraps << " wraps, max error " << juce::String(maxError, 0) << " samples"
+				<< (casePassed ? "\n" : " FAILED\n");
+		}
+	}
+
+	thread.stopThread(1000);
+	result << (passed ? "Passed\n" : "Failed\n");
+	return passed;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Plays an A-B loop between the file source and the transport. When the read
+// position reaches B the block is split at that exact sample and continues
+// from A, with a short crossfade from the audio after B to hide the seam.
+//
+// The first part of the loop (and the seam tail after B) is decoded ahead of
+// time on the read-ahead thread with a separate reader, so a wrap plays from
+// memory while the source catches up behind it instead of stalling on disk.
+// A new loop range takes effect once its head has been decoded; until then
+// the previous loop carries on.
+class LoopSegmentSource : public juce::PositionableAudioSource,
+	private juce::TimeSliceClient
+{
+public:
+	static constexpr double headSeconds = 0.5;
+	static constexpr double seamSeconds = 0.002;
+
+	// headReader must be a reader for the same file as the source, and is
+	// only used from the read-ahead thread
+	LoopSegmentSource(juce::PositionableAudioSource& sourceToLoop, juce::AudioFormatReader& headReader,
+		juce::TimeSliceThread& readAheadThread);
+	~LoopSegmentSource() override;
+
+	// Message thread. Positions are in source samples.
+	void setLoopRange(juce::int64 startSample, juce::int64 endSample);
+	void clearLoopRange() { setLoopRange(0, 0); }
+
+	// Message thread: true once the head for the latest range is decoded and
+	// waiting for the audio thread
+	bool isLoopHeadReady() const noexcept;
+
+	// Audio thread: true while the loop head is being played from memory
+	bool isPlayingLoopHead() const noexcept { return headPosition.load(std::memory_order_relaxed) >= 0; }
+
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+	void releaseResources() override;
+	void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+	void setNextReadPosition(juce::int64 newPosition) override;
+	juce::int64 getNextReadPosition() const override;
+	juce::int64 getTotalLength() const override { return source.getTotalLength(); }
+	bool isLooping() const override { return source.isLooping(); }
+	void setLooping(bool shouldLoop) override { source.setLooping(shouldLoop); }
+
+private:
+	// A loop range together with its decoded head, published as one
+	struct Head
+	{
+		juce::int64 start = 0;
+		juce::int64 end = 0;
+		int numSamples = 0;
+		juce::AudioBuffer<float> samples;
+		juce::AudioBuffer<float> tail;
+	};
+
+	juce::PositionableAudioSource& source;
+	juce::AudioFormatReader& reader;
+	juce::TimeSliceThread& thread;
+
+	const int headLength;
+	const int seamLength;
+	juce::HeapBlock<float> seamFadeIn;
+
+	// Requested by the message thread under requestLock, and picked up from
+	// there by the read-ahead thread
+	juce::SpinLock requestLock;
+	juce::int64 requestedStart = 0;
+	juce::int64 requestedEnd = 0;
+	int requestSerial = 0;
+	int filledSerial = 0;
+	std::atomic<int> publishedSerial{ 0 };
+
+	// A triple buffer: the read-ahead thread fills the back head and swaps it
+	// into the middle, and the audio thread swaps the middle one to the front
+	// once it has finished playing from the one it holds. Neither side waits,
+	// and the front head stays untouched for as long as the audio thread
+	// uses it.
+	static constexpr int headIndexMask = 3;
+	static constexpr int freshHead = 4;
+
+	Head heads[3];
+	std::atomic<int> middleHead{ 1 };
+	int backHead = 2;
+
+	// Audio thread
+	int frontHead = 0;
+	bool readingHead = false;
+	int headReadPos = 0;
+	int seamPos = 0;
+
+	std::atomic<juce::int64> seekRequest{ -1 };
+	std::atomic<juce::int64> headPosition{ -1 };
+
+	int useTimeSlice() override;
+	void applySeam(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, const Head& loopHead) noexcept;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopSegmentSource)
+};
+
+// Plays a ramp, whose every sample holds its own position, through a
+// LoopSegmentSource at several loop lengths and block sizes, and reports how
+// far the output strays from a sample-exact wrap outside the seam crossfade.
+// Appends the report to result and returns false if any wrap was off.
+bool runLoopBoundaryTest(juce::String& result);
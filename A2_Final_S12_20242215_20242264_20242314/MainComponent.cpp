@@ -1,4 +1,5 @@
 #include "MainComponent.h"
+#include "AllocationGuard.h"
 
 // ==================== PlaylistComponent ====================
 
@@ -20,6 +21,48 @@ PlaylistComponent::PlaylistComponent()
 		addAndMakeVisible(btn);
 	}
 
+	cancelScanButton.addListener(this);
+	addChildComponent(cancelScanButton);
+
+	scanner.onResults = [this](const std::vector<MetadataScanner::Result>& results) { addScannedTracks(results); };
+	scanner.onFinished = [this]()
+		{
+			numRowsToVerify = nextRowToVerify = 0;
+			cancelScanButton.setVisible(false);
+			updateStatsLabel();
+			library.save(playlist);
+		};
+
+	autoNextButton.onClick = [this]()
+		{
+			autoNextEnabled = autoNextButton.getToggleState();
+			queueNextTrack();
+		};
+	addAndMakeVisible(autoNextButton);
+
+	shuffleButton.onClick = [this]()
+		{
+			shuffleEnabled = shuffleButton.getToggleState();
+
+			if (shuffleEnabled)
+				shuffleOrder.reset((int)playlist.size(), currentTrackIndex);
+
+			queueNextTrack();
+		};
+	addAndMakeVisible(shuffleButton);
+
+	crossfadeSlider.setRange(0.0, 10.0, 0.5);
+	crossfadeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+	crossfadeSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 45, 20);
+	crossfadeSlider.setTextValueSuffix(" s");
+	crossfadeSlider.onValueChange = [this]()
+		{
+			if (crossfadeChanged)
+				crossfadeChanged(crossfadeSlider.getValue());
+		};
+	addAndMakeVisible(crossfadeSlider);
+	addAndMakeVisible(crossfadeLabel);
+
 	titleLabel.setText("PLAYLIST MANAGER", juce::dontSendNotification);
 	titleLabel.setJustificationType(juce::Justification::centred);
 	titleLabel.setFont(juce::Font(18.0f, juce::Font::bold));
@@ -28,12 +71,40 @@ PlaylistComponent::PlaylistComponent()
 	statsLabel.setText("0 tracks", juce::dontSendNotification);
 	addAndMakeVisible(statsLabel);
 
+	searchBox.setTextToShowWhenEmpty("Search title, artist or file name", juce::Colours::grey);
+	searchBox.onTextChange = [this]()
+		{
+			updateFilter();
+			updateStatsLabel();
+			table.updateContent();
+			table.repaint();
+		};
+	addAndMakeVisible(searchBox);
+
 	applyThemeToComponents();
+
+	// Show last session's playlist at once and check it for changed files
+	// in the background
+	playlist = library.load();
+
+	for (int i = 0; i < (int)playlist.size(); ++i)
+		searchIndex.setTrack(i, playlist[(size_t)i]);
+
+	if (!playlist.empty())
+	{
+		numRowsToVerify = (int)playlist.size();
+		scanner.rescan(playlist);
+		cancelScanButton.setVisible(true);
+		table.updateContent();
+	}
+
+	updateStatsLabel();
 }
 
 PlaylistComponent::~PlaylistComponent()
 {
 	ThemeManager::getInstance().removeListener(this);
+	library.save(playlist);
 }
 
 void PlaylistComponent::themeChanged()
@@ -56,9 +127,34 @@ void PlaylistComponent::applyThemeToComponents()
 	nextButton.setColour(juce::TextButton::textColourOffId, juce::Colours::white);
 	prevButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff7f8c8d));
 	prevButton.setColour(juce::TextButton::textColourOffId, juce::Colours::white);
+	autoNextButton.setColour(juce::ToggleButton::textColourId, colors.text);
+	autoNextButton.setColour(juce::ToggleButton::tickColourId, colors.accent);
+	shuffleButton.setColour(juce::ToggleButton::textColourId, colors.text);
+	shuffleButton.setColour(juce::ToggleButton::tickColourId, colors.accent);
+	crossfadeLabel.setColour(juce::Label::textColourId, colors.text);
+	crossfadeSlider.setColour(juce::Slider::thumbColourId, colors.sliderThumb);
+	crossfadeSlider.setColour(juce::Slider::trackColourId, colors.sliderTrack);
+	crossfadeSlider.setColour(juce::Slider::textBoxTextColourId, colors.text);
+	crossfadeSlider.setColour(juce::Slider::textBoxBackgroundColourId, colors.secondaryBackground);
+	crossfadeSlider.setColour(juce::Slider::textBoxOutlineColourId, colors.border);
+	cancelScanButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff7f8c8d));
+	cancelScanButton.setColour(juce::TextButton::textColourOffId, juce::Colours::white);
 
 	titleLabel.setColour(juce::Label::textColourId, colors.accent);
 	statsLabel.setColour(juce::Label::textColourId, colors.textSecondary);
+
+	searchBox.setColour(juce::TextEditor::backgroundColourId, colors.secondaryBackground);
+	searchBox.setColour(juce::TextEditor::textColourId, colors.text);
+	searchBox.setColour(juce::TextEditor::outlineColourId, colors.border);
+	searchBox.setColour(juce::TextEditor::focusedOutlineColourId, colors.accent);
+	searchBox.applyColourToAllText(colors.text);
+
+	cellColours.row = colors.tableRow;
+	cellColours.rowAlt = colors.tableRowAlt;
+	cellColours.selected = colors.tableSelected;
+	cellColours.playing = juce::Colour(0xff2a4a2a);
+	cellColours.text = colors.textSecondary;
+	cellColours.selectedText = colors.text;
 }
 
 void PlaylistComponent::paint(juce::Graphics& g)
@@ -82,9 +178,20 @@ void PlaylistComponent::resized()
 	prevButton.setBounds(btnArea.removeFromLeft(70));
 	btnArea.removeFromLeft(5);
 	nextButton.setBounds(btnArea.removeFromLeft(70));
+	btnArea.removeFromLeft(10);
+	autoNextButton.setBounds(btnArea.removeFromLeft(90));
+	btnArea.removeFromLeft(5);
+	shuffleButton.setBounds(btnArea.removeFromLeft(80));
+	btnArea.removeFromLeft(5);
+	crossfadeLabel.setBounds(btnArea.removeFromLeft(40));
+	crossfadeSlider.setBounds(btnArea.removeFromLeft(150));
+	btnArea.removeFromLeft(10);
+	cancelScanButton.setBounds(btnArea.removeFromLeft(90));
 
 	area.removeFromTop(5);
-	statsLabel.setBounds(area.removeFromTop(20));
+	auto statsArea = area.removeFromTop(24);
+	searchBox.setBounds(statsArea.removeFromRight(260));
+	statsLabel.setBounds(statsArea);
 	area.removeFromTop(3);
 
 	table.setBounds(area);
@@ -92,74 +199,215 @@ void PlaylistComponent::resized()
 
 int PlaylistComponent::getNumRows()
 {
-	return (int)playlist.size();
+	return filtering ? (int)visibleTracks.size() : (int)playlist.size();
 }
 
-void PlaylistComponent::paintRowBackground(juce::Graphics& g, int rowNumber, int width, int height, bool rowIsSelected)
+int PlaylistComponent::getTrackIndex(int rowNumber) const
 {
-	auto& colors = ThemeManager::getInstance().getColors();
+	if (!filtering)
+		return rowNumber < (int)playlist.size() ? rowNumber : -1;
 
-	if (rowIsSelected)
-		g.fillAll(colors.tableSelected);
-	else if (rowNumber == currentTrackIndex)
-		g.fillAll(juce::Colour(0xff2a4a2a));
-	else if (rowNumber % 2 == 0)
-		g.fillAll(colors.tableRow);
+	return rowNumber < (int)visibleTracks.size() ? visibleTracks[(size_t)rowNumber] : -1;
+}
+
+void PlaylistComponent::updateFilter()
+{
+	const auto query = searchBox.getText().trim();
+	filtering = query.isNotEmpty();
+
+	if (filtering)
+		searchIndex.search(query, visibleTracks);
 	else
-		g.fillAll(colors.tableRowAlt);
+		visibleTracks.clear();
+}
+
+void PlaylistComponent::paintRowBackground(juce::Graphics& g, int rowNumber, int width, int height, bool rowIsSelected)
+{
+	paintTrackRowBackground(g, rowNumber, getTrackIndex(rowNumber) == currentTrackIndex, rowIsSelected);
 }
 
 void PlaylistComponent::paintCell(juce::Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected)
 {
-	if (rowNumber >= playlist.size())
+	const int trackIndex = getTrackIndex(rowNumber);
+	if (trackIndex < 0)
 		return;
 
-	auto& colors = ThemeManager::getInstance().getColors();
-	g.setColour(rowIsSelected ? colors.text : colors.textSecondary);
-	g.setFont(12.0f);
+	paintTrackCell(g, cellText, playlist[(size_t)trackIndex], trackIndex, columnId, width, height, rowIsSelected);
+}
+
+void PlaylistComponent::paintTrackRowBackground(juce::Graphics& g, int rowNumber, bool isPlaying, bool rowIsSelected) const
+{
+	if (rowIsSelected)
+		g.fillAll(cellColours.selected);
+	else if (isPlaying)
+		g.fillAll(cellColours.playing);
+	else if (rowNumber % 2 == 0)
+		g.fillAll(cellColours.row);
+	else
+		g.fillAll(cellColours.rowAlt);
+}
 
-	const auto& track = playlist[rowNumber];
-	juce::String text;
+void PlaylistComponent::paintTrackCell(juce::Graphics& g, CellTextCache& cache, const TrackInfo& track, int trackIndex,
+	int columnId, int width, int height, bool rowIsSelected) const
+{
+	const juce::String* text = nullptr;
 
 	switch (columnId)
 	{
-	case 1: text = track.title; break;
-	case 2: text = track.artist; break;
-	case 3:
-	{
-		int mins = (int)track.duration / 60;
-		int secs = (int)track.duration % 60;
-		text = juce::String(mins) + ":" + juce::String(secs).paddedLeft('0', 2);
-		break;
-	}
-	case 4: text = "Load P1"; break;
-	case 5: text = "Load P2"; break;
+	case 1: text = &track.title; break;
+	case 2: text = &track.artist; break;
+	case 3: text = &track.durationText; break;
+	case 4: text = &loadP1Text; break;
+	case 5: text = &loadP2Text; break;
+	default: return;
 	}
 
-	g.drawText(text, 2, 0, width - 4, height, juce::Justification::centredLeft, true);
+	g.setColour(rowIsSelected ? cellColours.selectedText : cellColours.text);
+	cache.draw(g, (juce::int64)trackIndex * 8 + columnId, *text, { 2, 0, width - 4, height });
 }
 
 void PlaylistComponent::cellClicked(int rowNumber, int columnId, const juce::MouseEvent& e)
 {
-	if (rowNumber >= playlist.size())
+	const int trackIndex = getTrackIndex(rowNumber);
+	if (trackIndex < 0)
 		return;
 
-	const auto& track = playlist[rowNumber];
+	const auto& track = playlist[(size_t)trackIndex];
+
+	if (shuffleEnabled && ((columnId == 4 && loadToPlayer1) || (columnId == 5 && loadToPlayer2)))
+		shuffleOrder.moveTo(trackIndex);
 
 	if (columnId == 4 && loadToPlayer1)
 	{
 		loadToPlayer1(track.file);
-		currentTrackIndex = rowNumber;
+		currentTrackIndex = trackIndex;
+		activePlayer = 1;
+		queueNextTrack();
 	}
 	else if (columnId == 5 && loadToPlayer2)
 	{
 		loadToPlayer2(track.file);
-		currentTrackIndex = rowNumber;
+		currentTrackIndex = trackIndex;
+		activePlayer = 2;
+		queueNextTrack();
 	}
 
 	table.repaint();
 }
 
+bool PlaylistComponent::keyPressed(const juce::KeyPress& key)
+{
+	if (key == juce::KeyPress('b', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+	{
+		const auto result = runScrollBenchmark();
+
+		juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::InfoIcon, "Playlist scroll benchmark",
+			juce::String(result.numFrames) + " frames over " + juce::String(result.numRows) + " rows\n"
+			+ "average " + juce::String(result.averageMs, 3) + " ms, median " + juce::String(result.medianMs, 3) + " ms\n"
+			+ "slowest 10% from " + juce::String(result.slowestTenthMs, 3) + " ms, worst " + juce::String(result.worstMs, 3) + " ms");
+		return true;
+	}
+
+	return false;
+}
+
+// Made-up tracks, drawn exactly as the playlist draws its own
+class PlaylistComponent::BenchmarkModel : public juce::TableListBoxModel
+{
+public:
+	BenchmarkModel(const PlaylistComponent& playlistToDrawLike, int numRows)
+		: owner(playlistToDrawLike)
+	{
+		tracks.reserve((size_t)numRows);
+
+		for (int i = 0; i < numRows; ++i)
+		{
+			TrackInfo track;
+			track.title = "Benchmark Track " + juce::String(i);
+			track.artist = "Artist " + juce::String(i % 997);
+			track.setDuration((double)(90 + i % 400));
+			tracks.push_back(std::move(track));
+		}
+	}
+
+	int getNumRows() override { return (int)tracks.size(); }
+
+	void paintRowBackground(juce::Graphics& g, int rowNumber, int, int, bool rowIsSelected) override
+	{
+		owner.paintTrackRowBackground(g, rowNumber, false, rowIsSelected);
+	}
+
+	void paintCell(juce::Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override
+	{
+		if (juce::isPositiveAndBelow(rowNumber, (int)tracks.size()))
+			owner.paintTrackCell(g, cellText, tracks[(size_t)rowNumber], rowNumber, columnId, width, height, rowIsSelected);
+	}
+
+private:
+	const PlaylistComponent& owner;
+	std::vector<TrackInfo> tracks;
+	CellTextCache cellText{ juce::Font(12.0f) };
+};
+
+PlaylistComponent::ScrollBenchmark PlaylistComponent::runScrollBenchmark(int numRows, int numFrames)
+{
+	ScrollBenchmark result;
+
+	if (numRows <= 0 || numFrames <= 0 || table.getWidth() <= 0 || table.getHeight() <= 0)
+		return result;
+
+	// A separate table with the same columns, size and colours, so scan
+	// results and track changes arriving meanwhile only ever see the real one
+	BenchmarkModel model(*this, numRows);
+	juce::TableListBox benchmarkTable({}, &model);
+	auto& header = table.getHeader();
+
+	for (int i = 0; i < header.getNumColumns(true); ++i)
+	{
+		const int columnId = header.getColumnIdOfIndex(i, true);
+		benchmarkTable.getHeader().addColumn(header.getColumnName(columnId), columnId, header.getColumnWidth(columnId));
+	}
+
+	benchmarkTable.setRowHeight(table.getRowHeight());
+	benchmarkTable.setColour(juce::ListBox::backgroundColourId, table.findColour(juce::ListBox::backgroundColourId));
+	benchmarkTable.setBounds(table.getLocalBounds());
+	benchmarkTable.updateContent();
+
+	auto* viewport = benchmarkTable.getViewport();
+
+	if (viewport == nullptr)
+		return result;
+
+	juce::Image frame(juce::Image::RGB, benchmarkTable.getWidth(), benchmarkTable.getHeight(), false);
+	const int rowsPerFrame = 3;
+	const int scrollRange = juce::jmax(1, numRows * benchmarkTable.getRowHeight() - viewport->getViewHeight());
+	std::vector<double> frameMs;
+	frameMs.reserve((size_t)numFrames);
+
+	for (int i = 0; i < numFrames; ++i)
+	{
+		viewport->setViewPosition(0, (i * rowsPerFrame * benchmarkTable.getRowHeight()) % scrollRange);
+
+		const auto startTicks = juce::Time::getHighResolutionTicks();
+		{
+			juce::Graphics g(frame);
+			benchmarkTable.paintEntireComponent(g, false);
+		}
+		frameMs.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0);
+	}
+
+	result.numRows = numRows;
+	result.numFrames = numFrames;
+	result.averageMs = std::accumulate(frameMs.begin(), frameMs.end(), 0.0) / (double)numFrames;
+
+	std::sort(frameMs.begin(), frameMs.end());
+	result.medianMs = frameMs[frameMs.size() / 2];
+	result.slowestTenthMs = frameMs[frameMs.size() * 9 / 10];
+	result.worstMs = frameMs.back();
+
+	return result;
+}
+
 void PlaylistComponent::addFiles()
 {
 	fileChooser = std::make_unique<juce::FileChooser>(
@@ -171,25 +419,82 @@ void PlaylistComponent::addFiles()
 		juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles | juce::FileBrowserComponent::canSelectMultipleItems,
 		[this](const juce::FileChooser& fc)
 		{
-			auto files = fc.getResults();
-			for (const auto& file : files)
+			juce::Array<juce::File> files;
+			for (const auto& file : fc.getResults())
 			{
 				if (file.existsAsFile())
-				{
-					playlist.push_back(extractTrackInfo(file));
-				}
+					files.add(file);
 			}
+
+			if (files.isEmpty())
+				return;
+
+			scanner.scan(files);
+			cancelScanButton.setVisible(true);
 			updateStatsLabel();
-			table.updateContent();
 		});
 }
 
+void PlaylistComponent::addScannedTracks(const std::vector<MetadataScanner::Result>& results)
+{
+	for (const auto& result : results)
+	{
+		if (nextRowToVerify < numRowsToVerify)
+		{
+			const int index = nextRowToVerify++;
+			auto& row = playlist[(size_t)index];
+
+			if (row.isCurrent(result.size, result.modified))
+				continue;
+
+			row = result;
+			searchIndex.setTrack(index, result);
+		}
+		else
+		{
+			searchIndex.setTrack((int)playlist.size(), result);
+			playlist.push_back(result);
+
+			if (shuffleEnabled)
+				shuffleOrder.addTrack();
+		}
+
+		thumbnailStore->prepare(result.file, result.thumbnailKey);
+	}
+
+	// A new track can change what comes next, e.g. a shuffle slot right after
+	// the current track, so the deck is given the new choice
+	if (autoNextEnabled && peekNextIndex() != queuedTrackIndex)
+		queueNextTrack();
+
+	if (filtering)
+		updateFilter();
+
+	updateStatsLabel();
+	table.updateContent();
+}
+
+void PlaylistComponent::cancelScan()
+{
+	scanner.cancel();
+	numRowsToVerify = nextRowToVerify = 0;
+	cancelScanButton.setVisible(false);
+}
+
 void PlaylistComponent::clearPlaylist()
 {
+	cancelScan();
+
 	playlist.clear();
+	searchIndex.clear();
+	cellText.clear();
+	shuffleOrder.reset(0, -1);
+	updateFilter();
 	currentTrackIndex = -1;
+	queueNextTrack();
 	updateStatsLabel();
 	table.updateContent();
+	library.save(playlist);
 }
 
 void PlaylistComponent::buttonClicked(juce::Button* button)
@@ -202,6 +507,11 @@ void PlaylistComponent::buttonClicked(juce::Button* button)
 		playNext();
 	else if (button == &prevButton)
 		playPrevious();
+	else if (button == &cancelScanButton)
+	{
+		cancelScan();
+		updateStatsLabel();
+	}
 }
 
 void PlaylistComponent::updateStatsLabel()
@@ -212,87 +522,120 @@ void PlaylistComponent::updateStatsLabel()
 
 	int mins = (int)totalDuration / 60;
 	juce::String stats = juce::String(playlist.size()) + " tracks (" + juce::String(mins) + " minutes)";
+
+	if (filtering)
+		stats << " - " << (int)visibleTracks.size() << " shown";
+
+	if (scanner.isScanning())
+		stats << " - reading " << scanner.getNumDelivered() << " of " << scanner.getNumQueued() << " files";
+
 	statsLabel.setText(stats, juce::dontSendNotification);
 }
 
-PlaylistComponent::TrackInfo PlaylistComponent::extractTrackInfo(const juce::File& file)
+int PlaylistComponent::peekNextIndex() const
 {
-	TrackInfo info;
-	info.file = file;
-	info.title = file.getFileNameWithoutExtension();
-	info.artist = "Unknown";
-	info.duration = 0.0;
+	if (playlist.empty())
+		return -1;
 
-	juce::AudioFormatManager formatManager;
-	formatManager.registerBasicFormats();
+	if (shuffleEnabled)
+		return shuffleOrder.peekNext(repeatEnabled);
 
-	if (auto* reader = formatManager.createReaderFor(file))
-	{
-		info.title = reader->metadataValues.getValue("title", info.title);
-		info.artist = reader->metadataValues.getValue("artist", "Unknown");
-		info.duration = reader->lengthInSamples / reader->sampleRate;
-		delete reader;
-	}
+	if (currentTrackIndex + 1 < (int)playlist.size())
+		return currentTrackIndex + 1;
 
-	return info;
+	return repeatEnabled ? 0 : -1;
 }
 
-void PlaylistComponent::playNext()
+void PlaylistComponent::loadToActivePlayer(int index)
 {
-	if (playlist.empty())
+	currentTrackIndex = index;
+
+	auto& loadToActive = activePlayer == 2 ? loadToPlayer2 : loadToPlayer1;
+
+	if (loadToActive != nullptr)
+		loadToActive(playlist[index].file);
+
+	queueNextTrack();
+	table.repaint();
+}
+
+void PlaylistComponent::queueNextTrack()
+{
+	auto& queueOnActivePlayer = activePlayer == 2 ? queueOnPlayer2 : queueOnPlayer1;
+	queuedTrackIndex = -1;
+
+	if (queueOnActivePlayer == nullptr)
 		return;
 
-	if (shuffleEnabled && !shuffledIndices.empty())
-	{
-		auto it = std::find(shuffledIndices.begin(), shuffledIndices.end(), currentTrackIndex);
-		if (it != shuffledIndices.end() && ++it != shuffledIndices.end())
-			currentTrackIndex = *it;
-		else if (repeatEnabled)
-			currentTrackIndex = shuffledIndices[0];
-		else
-			return;
-	}
-	else
+	queuedTrackIndex = autoNextEnabled ? peekNextIndex() : -1;
+	queueOnActivePlayer(queuedTrackIndex >= 0 ? playlist[(size_t)queuedTrackIndex].file : juce::File());
+}
+
+void PlaylistComponent::trackAdvanced(int player)
+{
+	if (player != activePlayer)
+		return;
+
+	// The deck has moved on to the file it was given, which is not
+	// necessarily what peekNextIndex() would pick now
+	const int nextIndex = queuedTrackIndex;
+
+	if (juce::isPositiveAndBelow(nextIndex, (int)playlist.size()))
 	{
-		currentTrackIndex++;
-		if (currentTrackIndex >= playlist.size())
-		{
-			if (repeatEnabled)
-				currentTrackIndex = 0;
-			else
-				return;
-		}
+		currentTrackIndex = nextIndex;
+
+		if (shuffleEnabled)
+			shuffleOrder.moveTo(nextIndex);
 	}
 
+	queueNextTrack();
 	table.repaint();
 }
 
+void PlaylistComponent::playNext()
+{
+	const int nextIndex = peekNextIndex();
+
+	if (nextIndex < 0)
+		return;
+
+	if (shuffleEnabled)
+		shuffleOrder.moveTo(nextIndex);
+
+	loadToActivePlayer(nextIndex);
+}
+
 void PlaylistComponent::playPrevious()
 {
 	if (playlist.empty())
 		return;
 
-	if (shuffleEnabled && !shuffledIndices.empty())
+	int previousIndex = currentTrackIndex;
+
+	if (shuffleEnabled)
 	{
-		auto it = std::find(shuffledIndices.begin(), shuffledIndices.end(), currentTrackIndex);
-		if (it != shuffledIndices.begin())
-			currentTrackIndex = *(--it);
-		else if (repeatEnabled)
-			currentTrackIndex = shuffledIndices.back();
+		// Back through the tracks as they were played; at the very start
+		// the current track plays again
+		const int stepIndex = shuffleOrder.stepBack(repeatEnabled);
+
+		if (stepIndex >= 0)
+			previousIndex = stepIndex;
+		else if (previousIndex < 0)
+			return;
 	}
 	else
 	{
-		currentTrackIndex--;
-		if (currentTrackIndex < 0)
+		previousIndex--;
+		if (previousIndex < 0)
 		{
 			if (repeatEnabled)
-				currentTrackIndex = playlist.size() - 1;
+				previousIndex = (int)playlist.size() - 1;
 			else
-				currentTrackIndex = 0;
+				previousIndex = 0;
 		}
 	}
 
-	table.repaint();
+	loadToActivePlayer(previousIndex);
 }
 
 // ==================== MainComponent ====================
@@ -320,8 +663,18 @@ MainComponent::MainComponent()
 	mixerSlider.setValue(0.5);
 	mixerSlider.setSliderStyle(juce::Slider::LinearVertical);
 	mixerSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
+	mixerSlider.onValueChange = [this]() { updateCrossfade(); };
 	addAndMakeVisible(mixerSlider);
 
+	softClipButton.setTooltip("Soft-clip peaks before the master limiter");
+	softClipButton.onClick = [this]() { masterLimiter.setSoftClipEnabled(softClipButton.getToggleState()); };
+	addAndMakeVisible(softClipButton);
+	addAndMakeVisible(masterMeter);
+
+	deck1Index = deckMixer.addDeck(player1.getPlayerAudio());
+	deck2Index = deckMixer.addDeck(player2.getPlayerAudio());
+	updateCrossfade();
+
 	themeToggleButton.onClick = [this]()
 		{
 			auto& themeManager = ThemeManager::getInstance();
@@ -348,6 +701,55 @@ MainComponent::MainComponent()
 		player2.loadFile(file);
 		});
 
+	playlist.setPlayer1QueueCallback([this](const juce::File& file) {
+		player1.getPlayerAudio().queueNextFile(file);
+		});
+
+	playlist.setPlayer2QueueCallback([this](const juce::File& file) {
+		player2.getPlayerAudio().queueNextFile(file);
+		});
+
+	playlist.setCrossfadeCallback([this](double seconds) {
+		player1.getPlayerAudio().setCrossfadeSeconds(seconds);
+		player2.getPlayerAudio().setCrossfadeSeconds(seconds);
+		});
+
+	player1.onTrackAdvanced = [this]() { playlist.trackAdvanced(1); };
+	player2.onTrackAdvanced = [this]() { playlist.trackAdvanced(2); };
+
+	addChildComponent(profilerOverlay);
+	setWantsKeyboardFocus(true);
+
+	// Benchmarks run from the command line, before the audio device starts,
+	// and write their results to the log
+	const auto commandLine = juce::JUCEApplicationBase::getCommandLineParameters();
+
+	if (commandLine.contains("--stretch-benchmark"))
+		juce::Logger::writeToLog(runTimeStretchBenchmark());
+
+	if (commandLine.contains("--loop-test"))
+	{
+		juce::String report;
+
+		// A failure also shows in the exit code, for scripted runs
+		if (!runLoopBoundaryTest(report))
+			juce::JUCEApplicationBase::getInstance()->setApplicationReturnValue(1);
+
+		juce::Logger::writeToLog(report);
+	}
+
+	if (commandLine.contains("--eq-benchmark"))
+		juce::Logger::writeToLog(runEqualiserBenchmark());
+
+	// With more than two decks, the rest are rendered on one worker thread per
+	// spare core. --render-threads=N overrides that, and 0 turns it off.
+	int numRenderThreads = deckMixer.getNumDecks() > 2 ? juce::jmax(0, juce::SystemStats::getNumCpus() - 1) : 0;
+
+	if (commandLine.contains("--render-threads="))
+		numRenderThreads = commandLine.fromFirstOccurrenceOf("--render-threads=", false, false).getIntValue();
+
+	deckMixer.setNumRenderThreads(juce::jlimit(0, deckMixer.getMaxDecks() - 1, numRenderThreads));
+
 	setSize(1400, 900);
 	setAudioChannels(0, 2);
 }
@@ -378,55 +780,80 @@ void MainComponent::applyThemeToComponents()
 	mixerSlider.setColour(juce::Slider::textBoxBackgroundColourId, colors.secondaryBackground);
 	mixerSlider.setColour(juce::Slider::textBoxOutlineColourId, colors.border);
 
+	softClipButton.setColour(juce::ToggleButton::textColourId, colors.text);
+	softClipButton.setColour(juce::ToggleButton::tickColourId, colors.accent);
+
 	themeToggleButton.setColour(juce::TextButton::buttonColourId, colors.accent);
 	themeToggleButton.setColour(juce::TextButton::textColourOffId, colors.text);
 
 
 }
 
+void MainComponent::updateCrossfade()
+{
+	const float mixRatio = (float)mixerSlider.getValue();
+	deckMixer.setDeckGain(deck1Index, 1.0f - mixRatio);
+	deckMixer.setDeckGain(deck2Index, mixRatio);
+}
+
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-	player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
-	player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	deckMixer.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	masterLimiter.prepare(sampleRate, samplesPerBlockExpected);
+	masterLevels.prepare(sampleRate, samplesPerBlockExpected);
+	profiler.prepare(sampleRate);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-	bufferToFill.clearActiveBufferRegion();
+	AllocationGuard::ScopedNoAllocation noAllocation;
 
-	float mixRatio = mixerSlider.getValue();
-	float player1Gain = 1.0f - mixRatio;
-	float player2Gain = mixRatio;
+	profiler.beginCallback();
+	deckMixer.getNextAudioBlock(bufferToFill);
+	masterLimiter.process(bufferToFill);
+	masterLevels.process(bufferToFill);
 
-	juce::AudioBuffer<float> tempBuffer1(bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
-	juce::AudioBuffer<float> tempBuffer2(bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
-
-	tempBuffer1.clear();
-	tempBuffer2.clear();
-
-	juce::AudioSourceChannelInfo tempInfo1(&tempBuffer1, 0, bufferToFill.numSamples);
-	juce::AudioSourceChannelInfo tempInfo2(&tempBuffer2, 0, bufferToFill.numSamples);
+	for (int deckIndex = 0; deckIndex < deckMixer.getNumDecks(); ++deckIndex)
+	{
+		const auto ticks = deckMixer.getDeck(deckIndex).takeStageTicks();
+		profiler.setDeckTicks(deckIndex, ticks.source, ticks.stretch, ticks.eq, ticks.fade);
+	}
 
-	player1.getNextAudioBlock(tempInfo1);
-	player2.getNextAudioBlock(tempInfo2);
+	profiler.endCallback(bufferToFill.numSamples);
+}
 
-	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+bool MainComponent::keyPressed(const juce::KeyPress& key)
+{
+	if (key == juce::KeyPress('p', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
 	{
-		float* outputData = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
-		const float* input1 = tempBuffer1.getReadPointer(channel);
-		const float* input2 = tempBuffer2.getReadPointer(channel);
+		profilerOverlay.setVisible(!profilerOverlay.isVisible());
+		profilerOverlay.toFront(false);
+		return true;
+	}
 
-		for (int i = 0; i < bufferToFill.numSamples; ++i)
+	if (key == juce::KeyPress('w', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+	{
+		// Each showing starts the averages afresh
+		for (auto* player : { &player1, &player2 })
 		{
-			outputData[i] = (input1[i] * player1Gain) + (input2[i] * player2Gain);
+			auto& waveform = player->getWaveformDisplay();
+			const bool show = !waveform.isShowingFrameTime();
+
+			if (show)
+				waveform.resetFrameStats();
+
+			waveform.setShowFrameTime(show);
 		}
+
+		return true;
 	}
+
+	return false;
 }
 
 void MainComponent::releaseResources()
 {
-	player1.releaseResources();
-	player2.releaseResources();
+	deckMixer.releaseResources();
 }
 
 void MainComponent::paint(juce::Graphics& g)
@@ -446,11 +873,13 @@ void MainComponent::resized()
 
 	area.removeFromTop(5);
 
-	auto topSection = area.removeFromTop(350);
+	auto topSection = area.removeFromTop(400);
 
 	auto mixerArea = topSection.removeFromRight(80);
 	mixerLabel.setBounds(mixerArea.removeFromTop(25));
-	mixerSlider.setBounds(mixerArea.reduced(10, 5));
+	softClipButton.setBounds(mixerArea.removeFromBottom(24).reduced(5, 0));
+	masterMeter.setBounds(mixerArea.removeFromRight(14).reduced(0, 5));
+	mixerSlider.setBounds(mixerArea.reduced(5, 5));
 
 	topSection.removeFromRight(5);
 
@@ -463,4 +892,6 @@ void MainComponent::resized()
 
 	area.removeFromTop(10);
 	playlist.setBounds(area);
+
+	profilerOverlay.setBounds(10, 45, 440, 250);
 }
\ No newline at end of file
@@ -1,6 +1,14 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PlayerGUI.h"
+#include "DeckMixer.h"
+#include "MasterLimiter.h"
+#include "LevelMeter.h"
+#include "MetadataScanner.h"
+#include "PlaylistSearch.h"
+#include "CellTextCache.h"
+#include "ShuffleOrder.h"
+#include "ProfilerOverlay.h"
 
 class PlaylistComponent : public juce::Component,
 	public juce::TableListBoxModel,
@@ -19,6 +27,7 @@ public:
 	void paintRowBackground(juce::Graphics& g, int rowNumber, int width, int height, bool rowIsSelected) override;
 	void paintCell(juce::Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
 	void cellClicked(int rowNumber, int columnId, const juce::MouseEvent& e) override;
+	bool keyPressed(const juce::KeyPress& key) override;
 
 	void addFiles();
 	void clearPlaylist();
@@ -26,6 +35,17 @@ public:
 	void setPlayer1Callback(std::function<void(const juce::File&)> callback) { loadToPlayer1 = callback; }
 	void setPlayer2Callback(std::function<void(const juce::File&)> callback) { loadToPlayer2 = callback; }
 
+	// Hands the deck the file to continue with once its current track ends.
+	// An empty file clears whatever was queued.
+	void setPlayer1QueueCallback(std::function<void(const juce::File&)> callback) { queueOnPlayer1 = callback; }
+	void setPlayer2QueueCallback(std::function<void(const juce::File&)> callback) { queueOnPlayer2 = callback; }
+
+	// Called with the crossfade length, in seconds, that Auto Next should
+	// overlap tracks by. 0 plays them back to back without a gap.
+	void setCrossfadeCallback(std::function<void(double)> callback) { crossfadeChanged = callback; }
+
+	// Called when a deck has moved on to the file it was given to queue
+	void trackAdvanced(int player);
 
 	void playNext();
 	void playPrevious();
@@ -33,18 +53,33 @@ public:
 	int getCurrentTrackIndex() const { return currentTrackIndex; }
 	int getPlaylistSize() const { return playlist.size(); }
 
-private:
-	struct TrackInfo
+	// Scrolls a copy of the table, filled with numRows made-up tracks and
+	// drawn the same way, into an image a frame at a time. The real playlist
+	// is never touched. Ctrl+Shift+B runs it and shows the result.
+	struct ScrollBenchmark
 	{
-		juce::File file;
-		juce::String title;
-		juce::String artist;
-		double duration;
+		int numRows = 0;
+		int numFrames = 0;
+		double averageMs = 0.0;
+		double medianMs = 0.0;
+		double slowestTenthMs = 0.0;
+		double worstMs = 0.0;
 	};
 
+	ScrollBenchmark runScrollBenchmark(int numRows = 100000, int numFrames = 600);
+
+private:
+	using TrackInfo = LibraryIndex::Entry;
+	class BenchmarkModel;
+
 	std::vector<TrackInfo> playlist;
-	std::vector<int> shuffledIndices;
+	ShuffleOrder shuffleOrder;
 	int currentTrackIndex = -1;
+	int activePlayer = 1;
+
+	// The track last handed to the active deck to queue, or -1. This is what
+	// the deck plays when it advances, whatever peekNextIndex() says by then.
+	int queuedTrackIndex = -1;
 
 	bool shuffleEnabled = false;
 	bool repeatEnabled = false;
@@ -56,20 +91,73 @@ private:
 	juce::TextButton clearButton{ "Clear All" };
 	juce::TextButton nextButton{ "Next >>" };
 	juce::TextButton prevButton{ "<< Prev" };
+	juce::ToggleButton autoNextButton{ "Auto Next" };
+	juce::ToggleButton shuffleButton{ "Shuffle" };
+	juce::TextButton cancelScanButton{ "Cancel Scan" };
+	juce::Label crossfadeLabel{ {}, "Fade" };
+	juce::Slider crossfadeSlider;
 
 	juce::Label titleLabel;
 	juce::Label statsLabel;
+	juce::TextEditor searchBox;
+
+	// While searching, the table shows the tracks in visibleTracks, which
+	// holds indices into playlist. currentTrackIndex is always an index
+	// into playlist.
+	PlaylistSearchIndex searchIndex;
+	std::vector<int> visibleTracks;
+	bool filtering = false;
+
+	// What paintRowBackground and paintCell need, looked up once per theme
+	// change instead of once per cell
+	struct CellColours
+	{
+		juce::Colour row, rowAlt, selected, playing, text, selectedText;
+	};
+
+	CellColours cellColours;
+	CellTextCache cellText{ juce::Font(12.0f) };
+	const juce::String loadP1Text{ "Load P1" };
+	const juce::String loadP2Text{ "Load P2" };
 
 	std::function<void(const juce::File&)> loadToPlayer1;
 	std::function<void(const juce::File&)> loadToPlayer2;
+	std::function<void(const juce::File&)> queueOnPlayer1;
+	std::function<void(const juce::File&)> queueOnPlayer2;
+	std::function<void(double)> crossfadeChanged;
 
 	std::unique_ptr<juce::FileChooser> fileChooser;
 
+	// Waveforms for added files are built in the background, so loading one
+	// into a deck later finds it already on disk
+	juce::SharedResourcePointer<ThumbnailStore> thumbnailStore;
+
+	// Reads added files in the background; rows appear as they're read
+	MetadataScanner scanner;
+
+	// The playlist is saved between sessions. On startup its rows are shown
+	// straight from the index, then the first numRowsToVerify results from
+	// the scanner update them in place.
+	LibraryIndex library;
+	int numRowsToVerify = 0;
+	int nextRowToVerify = 0;
+
 	void buttonClicked(juce::Button* button) override;
 	void updateStatsLabel();
-	TrackInfo extractTrackInfo(const juce::File& file);
+	int peekNextIndex() const;
+	void loadToActivePlayer(int index);
+	void queueNextTrack();
+	void addScannedTracks(const std::vector<MetadataScanner::Result>& results);
+	void cancelScan();
+	int getTrackIndex(int rowNumber) const;
+	void updateFilter();
 	void applyThemeToComponents();
 
+	// Shared by the table and the scroll benchmark's copy of it
+	void paintTrackRowBackground(juce::Graphics& g, int rowNumber, bool isPlaying, bool rowIsSelected) const;
+	void paintTrackCell(juce::Graphics& g, CellTextCache& cache, const TrackInfo& track, int trackIndex,
+		int columnId, int width, int height, bool rowIsSelected) const;
+
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaylistComponent);
 };
 
@@ -86,6 +174,7 @@ public:
 	void resized() override;
 	void paint(juce::Graphics& g) override;
 	void themeChanged() override;
+	bool keyPressed(const juce::KeyPress& key) override;
 
 private:
 	PlayerGUI player1;
@@ -95,10 +184,28 @@ private:
 	juce::Label titleLabel;
 	juce::Slider mixerSlider;
 	juce::Label mixerLabel;
+	juce::ToggleButton softClipButton{ "Clip" };
 
 	juce::TextButton themeToggleButton{ "Light Mode" };
 
+	DeckMixer deckMixer;
+	int deck1Index = -1;
+	int deck2Index = -1;
+
+	// Keeps the summed decks under the ceiling before they reach the device
+	MasterLimiter masterLimiter;
+
+	// What goes to the device, measured after the limiter
+	LevelMeasurement masterLevels;
+	LevelMeter masterMeter{ masterLevels };
+
+	// Times each callback; Ctrl+Shift+P shows the figures. Ctrl+Shift+W
+	// shows how long each waveform takes to paint.
+	AudioProfiler profiler;
+	ProfilerOverlay profilerOverlay{ profiler, deviceManager, masterLimiter, deckMixer };
+
 	void applyThemeToComponents();
+	void updateCrossfade();
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
\ No newline at end of file
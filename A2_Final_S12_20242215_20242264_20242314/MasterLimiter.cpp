@@ -0,0 +1,153 @@
+#include "MasterLimiter.h"
+
+void MasterLimiter::setCeilingDecibels(float newCeiling) noexcept
+{
+	ceilingGain.store(juce::Decibels::decibelsToGain(juce::jmin(0.0f, newCeiling)));
+}
+
+void MasterLimiter::prepare(double newSampleRate, int samplesPerBlockExpected)
+{
+	sampleRate = newSampleRate;
+	blockSize = juce::jmax(1, samplesPerBlockExpected);
+	lookaheadSamples = juce::jmax(1, juce::roundToInt(sampleRate * lookaheadMs / 1000.0));
+	windowLength = lookaheadSamples + 1;
+
+	delayLines.setSize(maxChannels, lookaheadSamples + blockSize);
+	delayLines.clear();
+	peaks.allocate((size_t)blockSize, false);
+	gains.allocate((size_t)blockSize, false);
+
+	minimumGains.allocate((size_t)windowLength, false);
+	minimumPositions.allocate((size_t)windowLength, false);
+	minimumStart = numMinimums = 0;
+	position = 0;
+
+	envelope = 1.0f;
+	appliedReleaseMs = 0.0f;
+
+	averageHistory.allocate((size_t)windowLength, false);
+	std::fill(averageHistory.get(), averageHistory.get() + windowLength, 1.0f);
+	averageIndex = 0;
+	averageSum = (double)windowLength;
+
+	lastReduction.store(0.0f);
+	maxReduction.store(0.0f);
+}
+
+void MasterLimiter::process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+{
+	const int numChannels = juce::jmin(bufferToFill.buffer->getNumChannels(), maxChannels);
+
+	if (blockSize == 0 || numChannels == 0)
+		return;
+
+	if (const float release = releaseMs.load(std::memory_order_relaxed); release != appliedReleaseMs)
+	{
+		releaseCoefficient = (float)std::exp(-1000.0 / (release * sampleRate));
+		appliedReleaseMs = release;
+	}
+
+	float* channels[maxChannels] = {};
+	float smallestGain = 1.0f;
+
+	// Larger blocks than prepared for are processed in chunks, as in DeckMixer
+	for (int offset = 0; offset < bufferToFill.numSamples; offset += blockSize)
+	{
+		const int numSamples = juce::jmin(blockSize, bufferToFill.numSamples - offset);
+
+		for (int channel = 0; channel < numChannels; ++channel)
+			channels[channel] = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + offset);
+
+		processChunk(channels, numChannels, numSamples);
+		smallestGain = juce::jmin(smallestGain, juce::FloatVectorOperations::findMinimum(gains.get(), numSamples));
+	}
+
+	const float reduction = -juce::Decibels::gainToDecibels(smallestGain);
+	lastReduction.store(reduction, std::memory_order_relaxed);
+
+	if (reduction > maxReduction.load(std::memory_order_relaxed))
+		maxReduction.store(reduction, std::memory_order_relaxed);
+}
+
+void MasterLimiter::processChunk(float* const* channels, int numChannels, int numSamples) noexcept
+{
+	const float ceiling = ceilingGain.load(std::memory_order_relaxed);
+
+	if (softClipEnabled.load(std::memory_order_relaxed))
+		for (int channel = 0; channel < numChannels; ++channel)
+			softClip(channels[channel], numSamples, ceiling);
+
+	// The loudest channel at each sample, never below the ceiling, so the
+	// gain it needs is ceiling / peak and at most 1
+	juce::FloatVectorOperations::abs(peaks.get(), channels[0], numSamples);
+
+	for (int channel = 1; channel < numChannels; ++channel)
+	{
+		juce::FloatVectorOperations::abs(gains.get(), channels[channel], numSamples);
+		juce::FloatVectorOperations::max(peaks.get(), peaks.get(), gains.get(), numSamples);
+	}
+
+	juce::FloatVectorOperations::max(peaks.get(), peaks.get(), ceiling, numSamples);
+
+	for (int i = 0; i < numSamples; ++i)
+		gains[i] = nextGain(ceiling / peaks[i]);
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		float* line = delayLines.getWritePointer(channel);
+
+		juce::FloatVectorOperations::copy(line + lookaheadSamples, channels[channel], numSamples);
+		juce::FloatVectorOperations::multiply(channels[channel], line, gains.get(), numSamples);
+		std::memmove(line, line + numSamples, sizeof(float) * (size_t)lookaheadSamples);
+	}
+}
+
+float MasterLimiter::nextGain(float requiredGain) noexcept
+{
+	// Sliding minimum: the oldest value leaves once it's out of the window,
+	// and anything not smaller than the new value can never be the minimum again
+	if (numMinimums > 0 && minimumPositions[minimumStart] <= position - windowLength)
+	{
+		minimumStart = minimumStart + 1 == windowLength ? 0 : minimumStart + 1;
+		--numMinimums;
+	}
+
+	while (numMinimums > 0 && minimumGains[(minimumStart + numMinimums - 1) % windowLength] >= requiredGain)
+		--numMinimums;
+
+	const int back = (minimumStart + numMinimums) % windowLength;
+	minimumGains[back] = requiredGain;
+	minimumPositions[back] = position++;
+	++numMinimums;
+
+	// Falls at once and recovers over the release time; either way it stays
+	// at or below the windowed minimum
+	const float held = minimumGains[minimumStart];
+	envelope = held < envelope ? held : held + (envelope - held) * releaseCoefficient;
+
+	// Averaging over the window turns the steps into ramps as long as the
+	// look-ahead, which still reach each step's level by the time the delayed
+	// sample that needed it comes out
+	averageSum += envelope - averageHistory[averageIndex];
+	averageHistory[averageIndex] = envelope;
+	averageIndex = averageIndex + 1 == windowLength ? 0 : averageIndex + 1;
+
+	return (float)(averageSum / windowLength);
+}
+
+void MasterLimiter::softClip(float* data, int numSamples, float ceiling) noexcept
+{
+	// Straight up to the ceiling, then bending smoothly towards twice the
+	// ceiling. Short peaks lose their tips here instead of the limiter
+	// pulling the whole mix down for them.
+	for (int i = 0; i < numSamples; ++i)
+	{
+		const float magnitude = std::abs(data[i]);
+
+		if (magnitude > ceiling)
+		{
+			const float over = (magnitude - ceiling) / ceiling;
+			data[i] = std::copysign(ceiling * (1.0f + over / (1.0f + over)), data[i]);
+		}
+	}
+}
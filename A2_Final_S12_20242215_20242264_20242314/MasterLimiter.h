@@ -0,0 +1,84 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== MASTER LIMITER ====================
+
+// The last stage before the device: a look-ahead peak limiter that keeps the
+// summed decks under a ceiling, with an optional soft clipper in front of it.
+//
+// The output is delayed by the look-ahead, so the gain is already down when
+// a peak arrives. Each sample's gain is the smallest gain needed anywhere in
+// the look-ahead window (a sliding minimum), released on a one-pole curve and
+// then averaged over the window, which never leaves it above what any sample
+// in the window needs. Every step costs the same per sample whatever the
+// signal, and the per-channel work uses FloatVectorOperations, so it can
+// run on every block even at 32 samples.
+class MasterLimiter
+{
+public:
+	static constexpr int maxChannels = 2;
+	static constexpr double lookaheadMs = 1.5;
+
+	// Any thread
+	void setCeilingDecibels(float newCeiling) noexcept;
+	void setReleaseMs(float newReleaseMs) noexcept { releaseMs.store(juce::jmax(1.0f, newReleaseMs)); }
+	void setSoftClipEnabled(bool shouldClip) noexcept { softClipEnabled.store(shouldClip); }
+	bool isSoftClipEnabled() const noexcept { return softClipEnabled.load(); }
+
+	// Allocates; call before playback starts
+	void prepare(double sampleRate, int samplesPerBlockExpected);
+
+	// How far the output lags the input
+	int getLatencySamples() const noexcept { return lookaheadSamples; }
+	double getLatencyMs() const noexcept { return sampleRate > 0.0 ? 1000.0 * lookaheadSamples / sampleRate : 0.0; }
+
+	// Audio thread
+	void process(const juce::AudioSourceChannelInfo& bufferToFill) noexcept;
+
+	// Any thread. In dB below the input, so 0 means the limiter isn't acting.
+	float getGainReductionDecibels() const noexcept { return lastReduction.load(std::memory_order_relaxed); }
+
+	// The deepest reduction since the previous call
+	float takeMaxGainReductionDecibels() noexcept { return maxReduction.exchange(0.0f); }
+
+private:
+	std::atomic<float> ceilingGain{ 0.891f };
+	std::atomic<float> releaseMs{ 80.0f };
+	std::atomic<bool> softClipEnabled{ false };
+	std::atomic<float> lastReduction{ 0.0f };
+	std::atomic<float> maxReduction{ 0.0f };
+
+	double sampleRate = 0.0;
+	int blockSize = 0;
+	int lookaheadSamples = 0;
+
+	// Look-ahead plus the current block, per channel. The first
+	// lookaheadSamples hold the end of the previous block.
+	juce::AudioBuffer<float> delayLines;
+	juce::HeapBlock<float> peaks;
+	juce::HeapBlock<float> gains;
+
+	// Sliding minimum of the required gain: a ring of increasing values,
+	// each with the sample it was needed for
+	int windowLength = 0;
+	juce::HeapBlock<float> minimumGains;
+	juce::HeapBlock<juce::int64> minimumPositions;
+	int minimumStart = 0;
+	int numMinimums = 0;
+	juce::int64 position = 0;
+
+	float envelope = 1.0f;
+	float releaseCoefficient = 0.0f;
+	float appliedReleaseMs = 0.0f;
+
+	// Moving average of the envelope over the window
+	juce::HeapBlock<float> averageHistory;
+	int averageIndex = 0;
+	double averageSum = 0.0;
+
+	void processChunk(float* const* channels, int numChannels, int numSamples) noexcept;
+	float nextGain(float requiredGain) noexcept;
+	static void softClip(float* data, int numSamples, float ceiling) noexcept;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MasterLimiter)
+};
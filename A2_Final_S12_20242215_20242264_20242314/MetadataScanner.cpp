@@ -0,0 +1,142 @@
+#include "MetadataScanner.h"
+#include "ThumbnailStore.h"
+
+MetadataScanner::MetadataScanner()
+	: pool(juce::jlimit(1, 4, juce::SystemStats::getNumCpus() - 1))
+{
+}
+
+MetadataScanner::~MetadataScanner()
+{
+	cancel();
+
+	// Running jobs see the new generation and stop after their current file
+	pool.removeAllJobs(true, 10000);
+}
+
+void MetadataScanner::scan(const juce::Array<juce::File>& files)
+{
+	std::vector<LibraryIndex::Entry> entries((size_t)files.size());
+
+	for (int i = 0; i < files.size(); ++i)
+		entries[(size_t)i].file = files.getReference(i);
+
+	rescan(entries);
+}
+
+void MetadataScanner::rescan(const std::vector<LibraryIndex::Entry>& entries)
+{
+	const int scanGeneration = generation.load();
+	const int numEntries = (int)entries.size();
+	int firstIndex = 0;
+
+	{
+		const juce::ScopedLock sl(slotsLock);
+		firstIndex = (int)slots.size();
+		slots.resize(slots.size() + entries.size());
+	}
+
+	for (int start = 0; start < numEntries; start += filesPerJob)
+	{
+		std::vector<LibraryIndex::Entry> batch(entries.begin() + start, entries.begin() + juce::jmin(start + filesPerJob, numEntries));
+
+		pool.addJob([this, batch = std::move(batch), batchIndex = firstIndex + start, scanGeneration]
+			{
+				for (size_t i = 0; i < batch.size(); ++i)
+				{
+					if (generation.load() != scanGeneration)
+						return;
+
+					auto result = std::make_unique<Result>(update(batch[i], formats->manager));
+
+					const juce::ScopedLock sl(slotsLock);
+
+					if (generation.load() == scanGeneration)
+						slots[(size_t)batchIndex + i] = std::move(result);
+				}
+			});
+	}
+
+	startTimer(50);
+}
+
+void MetadataScanner::cancel()
+{
+	++generation;
+	pool.removeAllJobs(false, 0);
+
+	const juce::ScopedLock sl(slotsLock);
+	slots.clear();
+	numDelivered = 0;
+	stopTimer();
+}
+
+MetadataScanner::Result MetadataScanner::readMetadata(const juce::File& file, juce::AudioFormatManager& formats)
+{
+	Result info;
+	info.file = file;
+	info.title = file.getFileNameWithoutExtension();
+	info.artist = "Unknown";
+	info.size = file.getSize();
+	info.modified = file.getLastModificationTime().toMilliseconds();
+	info.thumbnailKey = ThumbnailStore::hashFor(file, info.size, info.modified);
+	info.setDuration(0.0);
+
+	if (std::unique_ptr<juce::AudioFormatReader> reader{ formats.createReaderFor(file) })
+	{
+		info.title = reader->metadataValues.getValue("title", info.title);
+		info.artist = reader->metadataValues.getValue("artist", "Unknown");
+		info.setDuration(reader->lengthInSamples / reader->sampleRate);
+		info.sampleRate = reader->sampleRate;
+	}
+
+	return info;
+}
+
+MetadataScanner::Result MetadataScanner::update(const LibraryIndex::Entry& entry, juce::AudioFormatManager& formats)
+{
+	// Only a stat for files that haven't changed. A missing file may be on
+	// a drive that isn't mounted, so it keeps what was known about it.
+	if (entry.size >= 0)
+	{
+		if (!entry.file.existsAsFile()
+			|| entry.isCurrent(entry.file.getSize(), entry.file.getLastModificationTime().toMilliseconds()))
+			return entry;
+	}
+
+	return readMetadata(entry.file, formats);
+}
+
+void MetadataScanner::timerCallback()
+{
+	std::vector<Result> ready;
+
+	{
+		const juce::ScopedLock sl(slotsLock);
+
+		// Deliver in queue order: stop at the first file still being read
+		while (numDelivered < (int)slots.size() && slots[(size_t)numDelivered] != nullptr)
+		{
+			ready.push_back(std::move(*slots[(size_t)numDelivered]));
+			slots[(size_t)numDelivered].reset();
+			++numDelivered;
+		}
+	}
+
+	if (!ready.empty() && onResults != nullptr)
+		onResults(ready);
+
+	if (isScanning())
+		return;
+
+	stopTimer();
+
+	{
+		const juce::ScopedLock sl(slotsLock);
+		slots.clear();
+		numDelivered = 0;
+	}
+
+	if (onFinished != nullptr)
+		onFinished();
+}
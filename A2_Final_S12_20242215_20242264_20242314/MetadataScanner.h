@@ -0,0 +1,61 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DeckTrack.h"
+#include "LibraryIndex.h"
+
+// ==================== METADATA SCANNER ====================
+
+// Reads the title, artist and duration of audio files on a pool of
+// background threads, using the format manager shared with the decks.
+// Results are handed back on the message thread in the order the files
+// were queued, a batch at a time, so a long scan can be shown as it goes.
+class MetadataScanner : private juce::Timer
+{
+public:
+	using Result = LibraryIndex::Entry;
+
+	MetadataScanner();
+	~MetadataScanner() override;
+
+	// Message thread. Adds files to the end of the current scan.
+	void scan(const juce::Array<juce::File>& files);
+
+	// Like scan(), but files whose size and modification time still match
+	// their entry are passed back as they are without being opened. So are
+	// files that can't be found.
+	void rescan(const std::vector<LibraryIndex::Entry>& entries);
+
+	// Drops everything that hasn't been delivered yet
+	void cancel();
+
+	bool isScanning() const { return numDelivered < (int)slots.size(); }
+	int getNumQueued() const { return (int)slots.size(); }
+	int getNumDelivered() const { return numDelivered; }
+
+	// Called on the message thread with the next results in order
+	std::function<void(const std::vector<Result>&)> onResults;
+
+	// Called on the message thread once everything queued has been delivered
+	std::function<void()> onFinished;
+
+	// Falls back to the file name when the file can't be read
+	static Result readMetadata(const juce::File& file, juce::AudioFormatManager& formats);
+	static Result update(const LibraryIndex::Entry& entry, juce::AudioFormatManager& formats);
+
+	static constexpr int filesPerJob = 16;
+
+private:
+	juce::SharedResourcePointer<SharedAudioFormats> formats;
+	juce::ThreadPool pool;
+
+	// One slot per queued file, filled in by the pool in any order. Bumping
+	// the generation makes jobs from a cancelled scan drop their results.
+	std::vector<std::unique_ptr<Result>> slots;
+	juce::CriticalSection slotsLock;
+	std::atomic<int> generation{ 0 };
+	int numDelivered = 0;
+
+	void timerCallback() override;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MetadataScanner)
+};
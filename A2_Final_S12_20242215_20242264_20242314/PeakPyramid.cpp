@@ -0,0 +1,303 @@
+#include "PeakPyramid.h"
+
+PeakPyramid::PeakPyramid(juce::TimeSliceThread& backgroundThread)
+	: thread(backgroundThread)
+{
+	thread.addTimeSliceClient(this);
+}
+
+PeakPyramid::~PeakPyramid()
+{
+	thread.removeTimeSliceClient(this);
+}
+
+void PeakPyramid::setReader(juce::AudioFormatReader* newReader)
+{
+	{
+		// Waits for at most one chunk to finish building
+		const juce::ScopedLock sl(buildLock);
+
+		reader.reset(newReader);
+		levels.clear();
+		++generation;
+		buildPosition = 0;
+		samplesBuilt.store(0);
+
+		{
+			const juce::ScopedLock wl(windowLock);
+			shownWindow.length = decodedWindow.length = decodingWindow.length = 0;
+			decodedWindowReady = false;
+			requestedWindowLength = 0;
+			shownWindow.serial = lastDecodedSerial = windowRequestSerial;
+		}
+
+		totalLength = reader != nullptr ? reader->lengthInSamples : 0;
+		sampleRate = reader != nullptr ? reader->sampleRate : 0.0;
+
+		for (juce::int64 binSize = baseBinSize; totalLength > 0; binSize *= binsPerParent)
+		{
+			Level level;
+			level.binSize = binSize;
+			level.bins.resize((size_t)((totalLength + binSize - 1) / binSize));
+			levels.push_back(std::move(level));
+
+			if (binSize >= totalLength)
+				break;
+		}
+	}
+
+	thread.moveToFrontOfQueue(this);
+}
+
+int PeakPyramid::useTimeSlice()
+{
+	const juce::ScopedLock sl(buildLock);
+
+	if (reader == nullptr)
+		return 500;
+
+	// A zoomed-in view is waiting on these, so they go ahead of the pyramid
+	if (decodeRequestedWindow())
+		return 0;
+
+	if (buildPosition >= totalLength)
+		return 500;
+
+	const int numSamples = (int)juce::jmin<juce::int64>(chunk.getNumSamples(), totalLength - buildPosition);
+	reader->read(&chunk, 0, numSamples, buildPosition, true, true);
+
+	buildBaseBins(numSamples);
+	buildPosition += numSamples;
+
+	const bool finished = buildPosition >= totalLength;
+
+	for (size_t i = 1; i < levels.size(); ++i)
+		buildParentBins(i, finished);
+
+	samplesBuilt.store(buildPosition);
+	return finished ? 500 : 0;
+}
+
+bool PeakPyramid::decodeRequestedWindow()
+{
+	{
+		const juce::ScopedLock wl(windowLock);
+
+		if (windowRequestSerial == lastDecodedSerial)
+			return false;
+
+		lastDecodedSerial = windowRequestSerial;
+		decodingWindow.start = requestedWindowStart;
+		decodingWindow.length = requestedWindowLength;
+		decodingWindow.serial = windowRequestSerial;
+	}
+
+	decodingWindow.samples.setSize(2, decodingWindow.length, false, false, true);
+	reader->read(&decodingWindow.samples, 0, decodingWindow.length, decodingWindow.start, true, true);
+
+	const juce::ScopedLock wl(windowLock);
+	std::swap(decodingWindow, decodedWindow);
+	decodedWindowReady = true;
+	return true;
+}
+
+void PeakPyramid::buildBaseBins(int numSamples)
+{
+	auto& level = levels.front();
+	const int numChannels = chunk.getNumChannels();
+
+	for (int offset = 0; offset < numSamples; offset += baseBinSize)
+	{
+		const int numInBin = juce::jmin(baseBinSize, numSamples - offset);
+		auto range = juce::FloatVectorOperations::findMinAndMax(chunk.getReadPointer(0, offset), numInBin);
+		float sumOfSquares = 0.0f;
+
+		for (int channel = 0; channel < numChannels; ++channel)
+		{
+			const auto* samples = chunk.getReadPointer(channel, offset);
+
+			if (channel > 0)
+				range = range.getUnionWith(juce::FloatVectorOperations::findMinAndMax(samples, numInBin));
+
+			for (int i = 0; i < numInBin; ++i)
+				sumOfSquares += samples[i] * samples[i];
+		}
+
+		auto& bin = level.bins[(size_t)level.numBuilt++];
+		bin.min = toBinValue(range.getStart());
+		bin.max = toBinValue(range.getEnd());
+		bin.rms = toBinValue(std::sqrt(sumOfSquares / (float)(numInBin * numChannels)));
+	}
+}
+
+void PeakPyramid::buildParentBins(size_t levelIndex, bool finished)
+{
+	const auto& children = levels[levelIndex - 1];
+	auto& level = levels[levelIndex];
+
+	// Until the file is done, only parents whose children are all in
+	const auto target = finished ? (juce::int64)level.bins.size() : children.numBuilt / binsPerParent;
+
+	for (; level.numBuilt < target; ++level.numBuilt)
+	{
+		const auto first = level.numBuilt * binsPerParent;
+		const auto last = juce::jmin(first + binsPerParent, children.numBuilt);
+
+		juce::int16 lowest = children.bins[(size_t)first].min;
+		juce::int16 highest = children.bins[(size_t)first].max;
+		float sumOfSquares = 0.0f;
+
+		for (auto i = first; i < last; ++i)
+		{
+			const auto& child = children.bins[(size_t)i];
+			lowest = juce::jmin(lowest, child.min);
+			highest = juce::jmax(highest, child.max);
+			sumOfSquares += juce::square(fromBinValue(child.rms));
+		}
+
+		auto& bin = level.bins[(size_t)level.numBuilt];
+		bin.min = lowest;
+		bin.max = highest;
+		bin.rms = toBinValue(std::sqrt(sumOfSquares / (float)(last - first)));
+	}
+}
+
+int PeakPyramid::getPeaks(juce::int64 startSample, juce::int64 endSample, Peak* peaks, int numColumns)
+{
+	if (numColumns <= 0 || endSample <= startSample || levels.empty())
+		return 0;
+
+	const double samplesPerColumn = (double)(endSample - startSample) / numColumns;
+
+	if (samplesPerColumn < baseBinSize)
+		return getSamplePeaks(startSample, endSample, peaks, numColumns);
+
+	size_t levelIndex = 0;
+
+	while (levelIndex + 1 < levels.size() && levels[levelIndex + 1].binSize <= samplesPerColumn)
+		++levelIndex;
+
+	const auto& level = levels[levelIndex];
+	const auto built = samplesBuilt.load();
+	const auto numReady = built >= totalLength ? (juce::int64)level.bins.size() : built / level.binSize;
+
+	// Each column touches at most binsPerParent + 2 bins of this level
+	for (int column = 0; column < numColumns; ++column)
+	{
+		const auto columnEnd = startSample + (juce::int64)((column + 1) * samplesPerColumn);
+		const auto first = (startSample + (juce::int64)(column * samplesPerColumn)) / level.binSize;
+		const auto last = juce::jmin(numReady, juce::jmax(first + 1, (columnEnd + level.binSize - 1) / level.binSize));
+
+		if (first < 0 || first >= last)
+			return column;
+
+		juce::int16 lowest = level.bins[(size_t)first].min;
+		juce::int16 highest = level.bins[(size_t)first].max;
+		float sumOfSquares = 0.0f;
+
+		for (auto i = first; i < last; ++i)
+		{
+			const auto& bin = level.bins[(size_t)i];
+			lowest = juce::jmin(lowest, bin.min);
+			highest = juce::jmax(highest, bin.max);
+			sumOfSquares += juce::square(fromBinValue(bin.rms));
+		}
+
+		peaks[column].min = fromBinValue(lowest);
+		peaks[column].max = fromBinValue(highest);
+		peaks[column].rms = std::sqrt(sumOfSquares / (float)(last - first));
+	}
+
+	return numColumns;
+}
+
+int PeakPyramid::getSamplePeaks(juce::int64 startSample, juce::int64 endSample, Peak* peaks, int numColumns)
+{
+	startSample = juce::jmax<juce::int64>(0, startSample);
+	endSample = juce::jmin(endSample, totalLength);
+
+	if (endSample <= startSample)
+		return 0;
+
+	const int length = (int)(endSample - startSample);
+	bool needsDecoding = false;
+
+	{
+		const juce::ScopedLock wl(windowLock);
+
+		if (decodedWindowReady)
+		{
+			std::swap(shownWindow, decodedWindow);
+			decodedWindowReady = false;
+		}
+
+		auto covers = [&](juce::int64 windowStart, int windowLength)
+			{
+				return startSample >= windowStart && endSample <= windowStart + windowLength;
+			};
+
+		const bool requestPending = windowRequestSerial != shownWindow.serial;
+
+		// Ask for a window either side of the view, so scrolling and zooming
+		// within it don't touch the file again
+		if (!covers(shownWindow.start, shownWindow.length)
+			&& !(requestPending && covers(requestedWindowStart, requestedWindowLength)))
+		{
+			requestedWindowStart = juce::jmax<juce::int64>(0, startSample - length);
+			requestedWindowLength = (int)juce::jmin<juce::int64>(3 * (juce::int64)length, totalLength - requestedWindowStart);
+			++windowRequestSerial;
+			needsDecoding = true;
+		}
+	}
+
+	if (needsDecoding)
+		thread.moveToFrontOfQueue(this);
+
+	// Until then, whatever the last window decoded covers
+	const auto& window = shownWindow;
+
+	if (window.length == 0 || startSample < window.start)
+		return 0;
+
+	const double samplesPerColumn = (double)length / numColumns;
+
+	for (int column = 0; column < numColumns; ++column)
+	{
+		const int first = (int)(startSample - window.start) + (int)(column * samplesPerColumn);
+		const int numInColumn = juce::jmax(1, (int)((column + 1) * samplesPerColumn) - (int)(column * samplesPerColumn));
+
+		if (first + numInColumn > window.length)
+			return column;
+
+		auto range = juce::FloatVectorOperations::findMinAndMax(window.samples.getReadPointer(0, first), numInColumn);
+		float sumOfSquares = 0.0f;
+
+		for (int channel = 0; channel < window.samples.getNumChannels(); ++channel)
+		{
+			const auto* samples = window.samples.getReadPointer(channel, first);
+
+			if (channel > 0)
+				range = range.getUnionWith(juce::FloatVectorOperations::findMinAndMax(samples, numInColumn));
+
+			for (int i = 0; i < numInColumn; ++i)
+				sumOfSquares += samples[i] * samples[i];
+		}
+
+		peaks[column].min = range.getStart();
+		peaks[column].max = range.getEnd();
+		peaks[column].rms = std::sqrt(sumOfSquares / (float)(numInColumn * window.samples.getNumChannels()));
+	}
+
+	return numColumns;
+}
+
+bool PeakPyramid::isDecodingSamples() const
+{
+	const juce::ScopedLock wl(windowLock);
+	return windowRequestSerial != shownWindow.serial;
+}
+
+juce::int16 PeakPyramid::toBinValue(float value) noexcept
+{
+	return (juce::int16)juce::roundToInt(juce::jlimit(-1.0f, 1.0f, value) * 32767.0f);
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== PEAK PYRAMID ====================
+
+// One low-priority background thread shared by every deck's peak pyramid
+class PeakPyramidThread : public juce::TimeSliceThread
+{
+public:
+	PeakPyramidThread() : juce::TimeSliceThread("Waveform Peaks")
+	{
+		startThread(juce::Thread::Priority::low);
+	}
+
+	~PeakPyramidThread() override
+	{
+		stopThread(2000);
+	}
+};
+
+// Min/max/RMS summaries of a file at several resolutions, for drawing its
+// waveform at any zoom. Level 0 summarises every 64 samples and each level
+// above it summarises four bins of the one below. A view is drawn from the
+// coarsest level with at least one bin per pixel, so a frame costs the same
+// handful of bins per pixel whether it shows the whole track or a fraction of
+// a second. Closer in than 64 samples per pixel the samples themselves are
+// read, also on the background thread.
+//
+// The levels are built from the start of the file on a background thread, a
+// chunk at a time, and the part built so far can be drawn in the meantime.
+// Channels are merged into one envelope and stored as 16-bit values.
+class PeakPyramid : private juce::TimeSliceClient
+{
+public:
+	static constexpr int baseBinSize = 64;
+	static constexpr int binsPerParent = 4;
+
+	struct Peak
+	{
+		float min = 0.0f;
+		float max = 0.0f;
+		float rms = 0.0f;
+	};
+
+	explicit PeakPyramid(juce::TimeSliceThread& backgroundThread);
+	~PeakPyramid() override;
+
+	// Message thread. Takes ownership of the reader; nullptr clears the pyramid.
+	void setReader(juce::AudioFormatReader* newReader);
+
+	juce::int64 getTotalLength() const noexcept { return totalLength; }
+	double getSampleRate() const noexcept { return sampleRate; }
+	bool isFullyBuilt() const noexcept { return samplesBuilt.load() >= totalLength; }
+
+	// Changes every time a reader is set, so views know to redraw
+	int getGeneration() const noexcept { return generation; }
+
+	// Message thread. Fills one Peak per pixel column for the samples in
+	// [startSample, endSample) and returns how many columns from the left
+	// could be filled from the part built so far.
+	int getPeaks(juce::int64 startSample, juce::int64 endSample, Peak* peaks, int numColumns);
+
+	// Message thread: true while samples asked for by a zoomed-in getPeaks()
+	// are still being decoded, so the view should be drawn again later
+	bool isDecodingSamples() const;
+
+private:
+	struct Bin
+	{
+		juce::int16 min = 0;
+		juce::int16 max = 0;
+		juce::int16 rms = 0;
+	};
+
+	struct Level
+	{
+		juce::int64 binSize = 0;
+		std::vector<Bin> bins;
+		juce::int64 numBuilt = 0; // background thread only
+	};
+
+	struct SampleWindow
+	{
+		juce::AudioBuffer<float> samples;
+		juce::int64 start = 0;
+		int length = 0;
+		int serial = 0;
+	};
+
+	juce::TimeSliceThread& thread;
+
+	// Replaced by the message thread under buildLock. The background thread
+	// only appends bins past samplesBuilt, so the message thread can draw
+	// everything before it without locking.
+	std::unique_ptr<juce::AudioFormatReader> reader;
+	std::vector<Level> levels;
+	juce::int64 totalLength = 0;
+	double sampleRate = 0.0;
+	std::atomic<juce::int64> samplesBuilt{ 0 };
+	juce::CriticalSection buildLock;
+	int generation = 0;
+
+	// Background thread
+	juce::int64 buildPosition = 0;
+	juce::AudioBuffer<float> chunk{ 2, 65536 };
+
+	// Decoded samples for views zoomed in past level 0. The message thread
+	// asks for a window and draws from the newest one decoded so far, and
+	// the background thread does the reading, so painting never waits on
+	// the file or on the builder. Each window belongs to one side and they
+	// only change hands under windowLock.
+	SampleWindow shownWindow;    // message thread
+	SampleWindow decodedWindow;  // decoded, waiting to be shown
+	SampleWindow decodingWindow; // background thread
+	bool decodedWindowReady = false;
+	juce::int64 requestedWindowStart = 0;
+	int requestedWindowLength = 0;
+	int windowRequestSerial = 0;
+	int lastDecodedSerial = 0;   // background thread
+	juce::CriticalSection windowLock;
+
+	int useTimeSlice() override;
+	bool decodeRequestedWindow();
+	void buildBaseBins(int numSamples);
+	void buildParentBins(size_t levelIndex, bool finished);
+	int getSamplePeaks(juce::int64 startSample, juce::int64 endSample, Peak* peaks, int numColumns);
+
+	static juce::int16 toBinValue(float value) noexcept;
+	static float fromBinValue(juce::int16 value) noexcept { return (float)value / 32767.0f; }
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PeakPyramid)
+};
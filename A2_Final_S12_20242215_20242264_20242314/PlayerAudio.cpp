@@ -2,176 +2,595 @@
 
 PlayerAudio::PlayerAudio()
 {
-	formatManager.registerBasicFormats();
+	thumbnail = std::make_unique<juce::AudioThumbnail>(ThumbnailStore::thumbnailResolution, formats->manager, *thumbnailStore);
 
-	thumbnailCache = std::make_unique<juce::AudioThumbnailCache>(5);
-	thumbnail = std::make_unique<juce::AudioThumbnail>(512, formatManager, *thumbnailCache);
+	// Also acts on finished fade-outs, so it runs fast enough for a stop or
+	// seek not to lag noticeably behind its fade
+	startTimer(10);
 }
 
 PlayerAudio::~PlayerAudio()
 {
+	stopTimer();
 }
 
 void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-	transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	blockSize = samplesPerBlockExpected;
+	deviceSampleRate = sampleRate;
+
+	transitionBuffer.setSize(2, juce::jmax(1, samplesPerBlockExpected));
+	crossfadeGains.setSize(2, transitionBuffer.getNumSamples());
+	setCrossfadeSeconds(crossfadeSeconds);
+
+	for (int i = 0; i <= crossfadeCurveSize; ++i)
+		crossfadeCurve[(size_t)i] = std::sin((float)i / (float)crossfadeCurveSize * juce::MathConstants<float>::halfPi);
+
+	// Fades left over from before the device stopped no longer apply
+	fadeCommands.drain([](FadeCommand) {});
+	gainRamp.prepare(sampleRate, fadeLengthMs, fadeCurve);
+	outputGain.prepare(sampleRate, gainRampSeconds);
+	outputLevels.prepare(sampleRate, samplesPerBlockExpected);
+	spectrumAnalyser.prepare(sampleRate);
+	equaliser.prepare(sampleRate);
+
+	if (track != nullptr)
+		track->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+	if (nextTrack != nullptr)
+		nextTrack->prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 void PlayerAudio::releaseResources()
 {
-	transportSource.releaseResources();
+	deviceSampleRate = 0.0;
+
+	if (track != nullptr)
+		track->releaseResources();
+
+	if (nextTrack != nullptr)
+		nextTrack->releaseResources();
 }
 
 bool PlayerAudio::loadFile(const juce::File& file)
 {
-	if (file.existsAsFile())
+	// Supersedes any background load still in flight
+	++loadGeneration;
+
+	if (auto newTrack = DeckTrack::open(file, formats->manager, getTrackSettings(), *readAheadThread))
 	{
-		if (auto* reader = formatManager.createReaderFor(file))
+		installTrack(std::move(newTrack));
+		return true;
+	}
+	return false;
+}
+
+void PlayerAudio::openTrackAsync(const juce::File& file, TrackOpenedCallback onOpened)
+{
+	// Shared between the loader job and the completion message. It also holds
+	// on to the read-ahead thread so a track that is never installed can
+	// still be torn down safely after the deck has gone.
+	struct PendingLoad
+	{
+		juce::SharedResourcePointer<ReadAheadThread> readAheadThread;
+		juce::SharedResourcePointer<SharedAudioFormats> formats;
+		std::unique_ptr<DeckTrack> track;
+	};
+
+	auto pending = std::make_shared<PendingLoad>();
+	const auto settings = getTrackSettings();
+	juce::WeakReference<PlayerAudio> weakThis(this);
+
+	loaderPool->pool.addJob([pending, file, settings, weakThis, onOpened]()
 		{
-			transportSource.stop();
-			transportSource.setSource(nullptr);
-			readerSource.reset();
+			pending->track = DeckTrack::open(file, pending->formats->manager, settings, *pending->readAheadThread);
+
+			juce::MessageManager::callAsync([pending, weakThis, onOpened]()
+				{
+					if (auto* player = weakThis.get())
+						onOpened(*player, std::move(pending->track));
+				});
+		});
+}
 
-			currentFileName = file.getFileNameWithoutExtension();
+void PlayerAudio::loadFileAsync(const juce::File& file, LoadCallback onComplete)
+{
+	const int generation = ++loadGeneration;
+	const double startTime = juce::Time::getMillisecondCounterHiRes();
 
-			metadata.title = reader->metadataValues.getValue("title", currentFileName);
-			metadata.artist = reader->metadataValues.getValue("artist", "Unknown Artist");
-			metadata.album = reader->metadataValues.getValue("album", "Unknown Album");
-			metadata.duration = reader->lengthInSamples / reader->sampleRate;
+	++numPendingLoads;
 
-			readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+	openTrackAsync(file, [file, generation, startTime, onComplete](PlayerAudio& player, std::unique_ptr<DeckTrack> newTrack)
+		{
+			--player.numPendingLoads;
 
-			transportSource.setSource(readerSource.get(), 0, nullptr, reader->sampleRate);
+			LoadResult result;
+			result.file = file;
+			result.latencyMs = juce::Time::getMillisecondCounterHiRes() - startTime;
 
-			thumbnail->setSource(new juce::FileInputSource(file));
+			if (newTrack != nullptr && generation == player.loadGeneration)
+			{
+				player.installTrack(std::move(newTrack));
+				result.success = true;
+			}
 
-			paused = false;
-			fadeCounter = 0;
-			return true;
-		}
+			if (onComplete != nullptr)
+				onComplete(result);
+		});
+}
+
+void PlayerAudio::queueNextFile(const juce::File& file)
+{
+	const int generation = ++queueGeneration;
+
+	if (file == juce::File())
+	{
+		fileToQueueAfterLoad = juce::File();
+		installNextTrack(nullptr);
+		return;
+	}
+
+	// Installing the track being loaded would clear the queue, so wait for it
+	if (isLoading())
+	{
+		fileToQueueAfterLoad = file;
+		return;
+	}
+
+	openTrackAsync(file, [generation](PlayerAudio& player, std::unique_ptr<DeckTrack> newTrack)
+		{
+			if (newTrack != nullptr && generation == player.queueGeneration)
+				player.installNextTrack(std::move(newTrack));
+		});
+}
+
+void PlayerAudio::setCrossfadeSeconds(double seconds)
+{
+	crossfadeSeconds = juce::jmax(0.0, seconds);
+	crossfadeSamples.store((int)(crossfadeSeconds * deviceSampleRate));
+}
+
+DeckTrack::Settings PlayerAudio::getTrackSettings() const
+{
+	DeckTrack::Settings settings;
+	settings.memoryMapping = memoryMappingEnabled;
+	settings.readAheadSamples = readAheadSamples;
+	settings.prefetchWindowSeconds = prefetchWindowSeconds;
+	settings.playbackSpeed = playbackSpeed;
+	settings.stretchQuality = stretchQuality;
+	settings.looping = isLooping;
+	settings.blockSize = blockSize;
+	settings.deviceSampleRate = deviceSampleRate;
+	return settings;
+}
+
+void PlayerAudio::prepareTrack(DeckTrack& trackToPrepare)
+{
+	// The device may have been reconfigured while the track was loading
+	if (deviceSampleRate > 0.0 && !trackToPrepare.isPreparedFor(blockSize, deviceSampleRate))
+		trackToPrepare.prepareToPlay(blockSize, deviceSampleRate);
+
+	if (segmentLooping)
+		trackToPrepare.setLoopRange(loopStart, loopEnd);
+}
+
+void PlayerAudio::installTrack(std::unique_ptr<DeckTrack> newTrack)
+{
+	prepareTrack(*newTrack);
+
+	const bool wasPlaying = isPlaying() && pendingAction == PendingAction::None;
+
+	currentFileName = newTrack->file.getFileNameWithoutExtension();
+	metadata = newTrack->metadata;
+
+	if (newTrack->thumbnailReader != nullptr)
+		thumbnail->setReader(newTrack->thumbnailReader.release(), newTrack->thumbnailHash);
+
+	peakPyramid.setReader(newTrack->peakReader.release());
+
+	if (wasPlaying)
+		newTrack->transport.start();
+
+	paused = false;
+	pendingAction = PendingAction::None;
+	seekPending = false;
+
+	if (wasPlaying)
+		postFade(fadeInEnabled ? FadeCommand::FadeInFromSilence : FadeCommand::Unity);
+
+	// An explicit load replaces whatever was queued
+	std::unique_ptr<DeckTrack> previousNext;
+
+	{
+		const juce::SpinLock::ScopedLockType lock(trackLock);
+		std::swap(track, newTrack);
+		std::swap(nextTrack, previousNext);
+		nextTrackActive.store(false);
+	}
+
+	// The previous tracks are released here, on the message thread rather
+	// than in the audio callback
+
+	if (fileToQueueAfterLoad != juce::File() && !isLoading())
+	{
+		auto fileToQueue = fileToQueueAfterLoad;
+		fileToQueueAfterLoad = juce::File();
+		queueNextFile(fileToQueue);
+	}
+}
+
+void PlayerAudio::installNextTrack(std::unique_ptr<DeckTrack> newTrack)
+{
+	// Never replace a queued track the audio thread has already switched to
+	if (nextTrackActive.load())
+		promoteNextTrack();
+
+	if (newTrack != nullptr)
+	{
+		prepareTrack(*newTrack);
+
+		// A started transport only advances once the audio thread pulls from
+		// it, so starting it here keeps transport calls off the audio thread
+		newTrack->transport.start();
+	}
+
+	{
+		const juce::SpinLock::ScopedLockType lock(trackLock);
+		std::swap(nextTrack, newTrack);
 	}
-	return false;
+}
+
+void PlayerAudio::promoteNextTrack()
+{
+	std::unique_ptr<DeckTrack> finishedTrack;
+
+	{
+		const juce::SpinLock::ScopedLockType lock(trackLock);
+		std::swap(finishedTrack, track);
+		std::swap(track, nextTrack);
+		nextTrackActive.store(false);
+	}
+
+	currentFileName = track->file.getFileNameWithoutExtension();
+	metadata = track->metadata;
+
+	if (track->thumbnailReader != nullptr)
+		thumbnail->setReader(track->thumbnailReader.release(), track->thumbnailHash);
+
+	peakPyramid.setReader(track->peakReader.release());
+
+	if (onTrackChanged != nullptr)
+		onTrackChanged();
+}
+
+void PlayerAudio::timerCallback()
+{
+	if (nextTrackActive.load())
+		promoteNextTrack();
+
+	if ((pendingAction != PendingAction::None || seekPending) && fadedOut.load())
+		completePendingAction();
 }
 
 void PlayerAudio::start()
 {
-	transportSource.start();
 	paused = false;
-	fadeCounter = 0;
+
+	// Still fading out from a stop or pause: fade straight back in, unless a
+	// seek is waiting for the silence
+	if (pendingAction != PendingAction::None)
+	{
+		pendingAction = PendingAction::None;
+
+		if (!seekPending)
+			postFade(FadeCommand::FadeIn);
+
+		return;
+	}
+
+	auto* active = getActiveTrack();
+
+	if (active != nullptr && !active->transport.isPlaying())
+	{
+		active->transport.start();
+		postFade(fadeInEnabled ? FadeCommand::FadeInFromSilence : FadeCommand::Unity);
+	}
 }
 
 void PlayerAudio::stop()
 {
-	transportSource.stop();
 	paused = false;
-	fadeCounter = 0;
+
+	if (pendingAction != PendingAction::None || seekPending || canFadeOut())
+	{
+		pendingAction = PendingAction::Stop;
+		beginFadeOut();
+		return;
+	}
+
+	if (auto* active = getActiveTrack())
+		active->transport.stop();
 }
 
 void PlayerAudio::pause()
 {
-	if (transportSource.isPlaying())
+	if (paused)
 	{
-		transportSource.stop();
-		paused = true;
+		if (hasFileLoaded())
+			start();
 	}
-	else if (paused)
+	else if (isPlaying())
 	{
-		transportSource.start();
-		paused = false;
-		fadeCounter = 0;
+		paused = true;
+
+		if (seekPending || canFadeOut())
+		{
+			pendingAction = PendingAction::Pause;
+			beginFadeOut();
+		}
+		else
+		{
+			getActiveTrack()->transport.stop();
+		}
 	}
 }
 
+bool PlayerAudio::canFadeOut() const
+{
+	return fadeOutEnabled && deviceSampleRate > 0.0 && isPlaying();
+}
+
+void PlayerAudio::beginFadeOut()
+{
+	fadedOut.store(false);
+	postFade(FadeCommand::FadeOut);
+}
+
+void PlayerAudio::completePendingAction()
+{
+	const auto action = pendingAction;
+	const bool shouldSeek = seekPending;
+
+	pendingAction = PendingAction::None;
+	seekPending = false;
+
+	auto* active = getActiveTrack();
+
+	if (active == nullptr)
+		return;
+
+	if (shouldSeek)
+		active->setPosition(pendingSeekPosition);
+
+	if (action == PendingAction::None)
+		postFade(FadeCommand::FadeIn);
+	else
+		active->transport.stop();
+}
+
 void PlayerAudio::setGain(float gain)
 {
 	currentGain = gain;
-	transportSource.setGain(gain);
+	outputGain.set(muted ? 0.0f : currentGain);
 }
 
 double PlayerAudio::getPosition() const
 {
-	return transportSource.getCurrentPosition();
+	if (seekPending)
+		return pendingSeekPosition;
+
+	auto* active = getActiveTrack();
+	return active != nullptr ? active->transport.getCurrentPosition() : 0.0;
 }
 
 double PlayerAudio::getLength() const
 {
-	return transportSource.getLengthInSeconds();
+	auto* active = getActiveTrack();
+	return active != nullptr ? active->transport.getLengthInSeconds() : 0.0;
 }
 
 void PlayerAudio::setMute(bool shouldMute)
 {
 	muted = shouldMute;
+	outputGain.set(muted ? 0.0f : currentGain);
 }
 
 void PlayerAudio::setLooping(bool shouldLoop)
 {
 	isLooping = shouldLoop;
 
-	if (readerSource != nullptr)
-		readerSource->setLooping(isLooping);
+	if (auto* active = getActiveTrack())
+		active->setLooping(isLooping);
 }
 
 bool PlayerAudio::isPlaying() const
 {
-	return transportSource.isPlaying();
+	auto* active = getActiveTrack();
+	return active != nullptr && active->transport.isPlaying();
 }
 
 double PlayerAudio::getLengthInSeconds() const
 {
-	return transportSource.getLengthInSeconds();
+	return getLength();
 }
 
 double PlayerAudio::getCurrentPosition() const
 {
-	return transportSource.getCurrentPosition();
+	return getPosition();
 }
 
 void PlayerAudio::setPosition(double newPosition)
 {
-	transportSource.setPosition(newPosition);
-	fadeCounter = 0;
+	// While audible, jump only once the output has faded out. A pending stop
+	// or pause is already on its way to silence and takes the seek with it.
+	if (pendingAction != PendingAction::None || seekPending || canFadeOut())
+	{
+		pendingSeekPosition = newPosition;
+		seekPending = true;
+		beginFadeOut();
+		return;
+	}
+
+	if (auto* active = getActiveTrack())
+		active->setPosition(newPosition);
+}
+
+void PlayerAudio::postFade(FadeCommand command)
+{
+	// Without a device there is no fade to run; the ramp starts out at unity
+	// when the device is next prepared
+	if (deviceSampleRate <= 0.0)
+		return;
+
+	const bool sent = fadeCommands.push(command);
+	jassertquiet(sent);
+}
+
+void PlayerAudio::applyFade(FadeCommand command) noexcept
+{
+	switch (command)
+	{
+	case FadeCommand::FadeIn:            gainRamp.fadeIn(); break;
+	case FadeCommand::FadeInFromSilence: gainRamp.fadeInFromSilence(); break;
+	case FadeCommand::FadeOut:           gainRamp.fadeOut(); break;
+	case FadeCommand::Unity:             gainRamp.setUnity(); break;
+	}
 }
 
 void PlayerAudio::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-	if (readerSource == nullptr)
+	// Taken even in a block the deck sits out, so the ramp never falls
+	// behind what the message thread asked for
+	fadeCommands.drain([this](FadeCommand command) { applyFade(command); });
+
+	// Only contended while the message thread swaps or rewires the track, in
+	// which case this deck sits out one block instead of stalling the mix
+	const juce::SpinLock::ScopedTryLockType lock(trackLock);
+	auto* active = lock.isLocked() ? getActiveTrack() : nullptr;
+
+	if (active == nullptr)
 	{
 		bufferToFill.clearActiveBufferRegion();
+		outputGain.advance(bufferToFill.numSamples);
+		outputLevels.process(bufferToFill);
 		return;
 	}
 
-	transportSource.getNextAudioBlock(bufferToFill);
+	if (active->isReadAheadBehind(bufferToFill.numSamples))
+		underrunCount.fetch_add(1, std::memory_order_relaxed);
 
-	// A-B loop
-	if (segmentLooping && transportSource.getCurrentPosition() >= loopEnd)
-	{
-		transportSource.setPosition(loopStart);
-		fadeCounter = 0;
-	}
+	const auto renderStartTicks = juce::Time::getHighResolutionTicks();
+
+	// A-B loops wrap inside the track's source chain, at the exact sample
+	if (!renderTransition(bufferToFill))
+		active->getNextAudioBlock(bufferToFill);
+
+	const auto eqStartTicks = juce::Time::getHighResolutionTicks();
+
+	equaliser.process(bufferToFill);
+
+	const auto fadeStartTicks = juce::Time::getHighResolutionTicks();
+
+	gainRamp.process(bufferToFill);
+	fadedOut.store(gainRamp.isSilent());
+
+	outputGain.applyGain(bufferToFill);
 
-	// Apply fade in/out
-	applyFade(bufferToFill);
+	const auto fadeEndTicks = juce::Time::getHighResolutionTicks();
+
+	outputLevels.process(bufferToFill);
+	spectrumAnalyser.pushSamples(bufferToFill);
+
+	// Both tracks count while a transition mixes them
+	juce::int64 sourceTicks = 0;
+
+	for (auto* deckTrack : { track.get(), nextTrack.get() })
+		if (deckTrack != nullptr)
+			sourceTicks += deckTrack->takeSourceTicks();
+
+	stageTicks.source += sourceTicks;
+	stageTicks.stretch += eqStartTicks - renderStartTicks - sourceTicks;
+	stageTicks.eq += fadeStartTicks - eqStartTicks;
+	stageTicks.fade += fadeEndTicks - fadeStartTicks;
 }
 
-void PlayerAudio::applyFade(const juce::AudioSourceChannelInfo& bufferToFill)
+bool PlayerAudio::renderTransition(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-	if (fadeInEnabled && fadeCounter < FADE_LENGTH_SAMPLES && transportSource.isPlaying())
+	if (nextTrack == nullptr || nextTrackActive.load() || isLooping.load() || segmentLooping.load()
+		|| transitionBuffer.getNumSamples() == 0)
+		return false;
+
+	const int numSamples = bufferToFill.numSamples;
+	const int fadeLength = crossfadeSamples.load(std::memory_order_relaxed);
+
+	// Output samples left in the current track, already scaled for speed.
+	// The transport stops once it has read to the end, which happens while
+	// the stretcher still holds the last few frames.
+	const auto remaining = track->getSamplesUntilEnd();
+
+	if (!track->transport.isPlaying() && !(track->transport.hasStreamFinished() && remaining > 0))
+		return false;
+
+	const auto fadeStart = remaining - fadeLength;
+
+	if (fadeStart >= numSamples)
+		return false;
+
+	// The current track renders silence past its end, so without a crossfade
+	// the next track simply takes over at sample 'remaining'
+	const int nextStart = (int)juce::jlimit<juce::int64>(0, numSamples, fadeStart);
+	const int numNextSamples = numSamples - nextStart;
+
+	track->getNextAudioBlock(bufferToFill);
+
+	// The next track renders in chunks of the prepared size, so a device
+	// that delivers a larger block still gets the crossfade
+	const int chunkSize = transitionBuffer.getNumSamples();
+	auto* currentGains = crossfadeGains.getWritePointer(0);
+	auto* nextGains = crossfadeGains.getWritePointer(1);
+
+	for (int offset = 0; offset < numNextSamples; offset += chunkSize)
 	{
-		int samplesToFade = juce::jmin(FADE_LENGTH_SAMPLES - fadeCounter, bufferToFill.numSamples);
+		const int chunkStart = nextStart + offset;
+		const int numChunkSamples = juce::jmin(chunkSize, numNextSamples - offset);
 
-		for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+		juce::AudioSourceChannelInfo nextInfo(&transitionBuffer, 0, numChunkSamples);
+		nextTrack->getNextAudioBlock(nextInfo);
+
+		// Equal-power crossfade: 0 = all current track, 1 = all next track
+		for (int i = 0; i < numChunkSamples; ++i)
 		{
-			float* channelData = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
+			const float x = fadeLength > 0
+				? juce::jlimit(0.0f, 1.0f, (float)(chunkStart + i - fadeStart) / (float)fadeLength)
+				: 1.0f;
 
-			for (int i = 0; i < samplesToFade; ++i)
-			{
-				float fadeFactor = (float)(fadeCounter + i) / (float)FADE_LENGTH_SAMPLES;
-				channelData[i] *= fadeFactor;
-			}
+			currentGains[i] = getCrossfadeGain(1.0f - x);
+			nextGains[i] = getCrossfadeGain(x);
 		}
 
-		fadeCounter += samplesToFade;
+		for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+		{
+			auto* out = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + chunkStart);
+			const auto* in = transitionBuffer.getReadPointer(juce::jmin(channel, transitionBuffer.getNumChannels() - 1));
+
+			juce::FloatVectorOperations::multiply(out, currentGains, numChunkSamples);
+			juce::FloatVectorOperations::addWithMultiply(out, in, nextGains, numChunkSamples);
+		}
 	}
+
+	// The current track has ended: from the next block on the queued track plays alone
+	if (remaining <= numSamples)
+		nextTrackActive.store(true);
+
+	return true;
+}
+
+float PlayerAudio::getCrossfadeGain(float x) const noexcept
+{
+	const float position = x * (float)crossfadeCurveSize;
+	const int index = juce::jmin((int)position, crossfadeCurveSize - 1);
+
+	return juce::jmap(position - (float)index, crossfadeCurve[(size_t)index], crossfadeCurve[(size_t)index + 1]);
 }
 
 void PlayerAudio::setLoopPoints(double start, double end)
@@ -179,18 +598,39 @@ void PlayerAudio::setLoopPoints(double start, double end)
 	loopStart = start;
 	loopEnd = end;
 	segmentLooping = true;
+
+	for (auto* deckTrack : { track.get(), nextTrack.get() })
+		if (deckTrack != nullptr)
+			deckTrack->setLoopRange(start, end);
 }
 
 void PlayerAudio::clearLoopPoints()
 {
 	segmentLooping = false;
+
+	for (auto* deckTrack : { track.get(), nextTrack.get() })
+		if (deckTrack != nullptr)
+			deckTrack->clearLoopRange();
 }
 
 void PlayerAudio::setPlaybackSpeed(double speed)
 {
 	playbackSpeed = speed;
-	transportSource.setSource(readerSource.get(), 0, nullptr,
-		readerSource ? readerSource->getAudioFormatReader()->sampleRate * speed : 44100.0);
+
+	// Speed is an atomic on the stretcher, so both tracks can be updated
+	// regardless of which one the audio thread is playing
+	for (auto* deckTrack : { track.get(), nextTrack.get() })
+		if (deckTrack != nullptr)
+			deckTrack->setPlaybackSpeed(speed);
+}
+
+void PlayerAudio::setTimeStretchQuality(TimeStretcher::Quality quality)
+{
+	stretchQuality = quality;
+
+	for (auto* deckTrack : { track.get(), nextTrack.get() })
+		if (deckTrack != nullptr)
+			deckTrack->setStretchQuality(quality);
 }
 
 juce::String PlayerAudio::getMetadata() const
@@ -205,5 +645,6 @@ juce::String PlayerAudio::getMetadata() const
 
 void PlayerAudio::createWaveformThumbnail(const juce::File& file)
 {
-	thumbnail->setSource(new juce::FileInputSource(file));
+	thumbnail->setReader(formats->manager.createReaderFor(file), ThumbnailStore::hashFor(file));
+	peakPyramid.setReader(formats->manager.createReaderFor(file));
 }
\ No newline at end of file
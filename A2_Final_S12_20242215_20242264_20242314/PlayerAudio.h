@@ -1,17 +1,55 @@
 #pragma once
 #include <JuceHeader.h>
-
-class PlayerAudio
+#include "DeckTrack.h"
+#include "GainRamp.h"
+#include "ThumbnailStore.h"
+#include "PeakPyramid.h"
+#include "RealtimeParameters.h"
+#include "LevelMeasurement.h"
+#include "SpectrumAnalyser.h"
+#include "DeckEqualiser.h"
+
+class PlayerAudio : private juce::Timer
 {
 public:
 	PlayerAudio();
-	~PlayerAudio();
+	~PlayerAudio() override;
 
 	void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
 	void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
 	void releaseResources();
 
+	// Opens the file on the calling thread
 	bool loadFile(const juce::File& file);
+
+	// Opens, probes and pre-buffers the file on a background thread, then
+	// swaps it into the deck between two audio blocks. If the deck was playing
+	// the new track starts straight away. The callback runs on the message
+	// thread; a load superseded by a newer one reports success = false.
+	struct LoadResult
+	{
+		juce::File file;
+		bool success = false;
+		double latencyMs = 0.0;
+	};
+
+	using LoadCallback = std::function<void(const LoadResult&)>;
+	void loadFileAsync(const juce::File& file, LoadCallback onComplete = nullptr);
+	bool isLoading() const { return numPendingLoads > 0; }
+
+	// Gapless playback: the queued file is opened and pre-buffered in the
+	// background, then spliced in on the audio thread at the exact sample the
+	// current track ends, or overlapped with an equal-power crossfade if a
+	// crossfade length is set. An empty file clears the queue.
+	void queueNextFile(const juce::File& file);
+	bool hasQueuedTrack() const { return nextTrack != nullptr; }
+
+	void setCrossfadeSeconds(double seconds);
+	double getCrossfadeSeconds() const { return crossfadeSeconds; }
+
+	// Called on the message thread after the deck has moved on to the queued track
+	std::function<void()> onTrackChanged;
+
 	void start();
 	void stop();
 	void pause();
@@ -38,9 +76,13 @@ public:
 	void setLoopPoints(double start, double end);
 	void clearLoopPoints();
 
+	// Changes tempo without changing pitch
 	void setPlaybackSpeed(double speed);
 	double getPlaybackSpeed() const { return playbackSpeed; }
 
+	void setTimeStretchQuality(TimeStretcher::Quality quality);
+	TimeStretcher::Quality getTimeStretchQuality() const { return stretchQuality; }
+
 	// Metadata retrieval
 	juce::String getMetadata() const;
 	juce::String getTitle() const { return metadata.title; }
@@ -51,49 +93,173 @@ public:
 	// Waveform data
 	void createWaveformThumbnail(const juce::File& file);
 	juce::AudioThumbnail* getThumbnail() { return thumbnail.get(); }
+	PeakPyramid& getPeakPyramid() { return peakPyramid; }
 
-	// Fade in/out
+	// Fade in/out. With fade-out on, stop, pause and seek wait for the output
+	// to fade to silence before they take effect.
 	void setFadeIn(bool shouldFade) { fadeInEnabled = shouldFade; }
 	void setFadeOut(bool shouldFade) { fadeOutEnabled = shouldFade; }
 
-	bool hasFileLoaded() const { return readerSource != nullptr; }
+	// Take effect the next time the device is prepared
+	void setFadeLengthMs(double lengthMs) { fadeLengthMs = juce::jmax(1.0, lengthMs); }
+	double getFadeLengthMs() const { return fadeLengthMs; }
+	void setFadeCurve(GainRamp::Curve curve) { fadeCurve = curve; }
+	GainRamp::Curve getFadeCurve() const { return fadeCurve; }
+
+	bool hasFileLoaded() const { return track != nullptr; }
+
+	// Read-ahead: file decoding happens on a shared background thread into a
+	// buffer of this many samples. 0 decodes directly in the audio callback.
+	// Takes effect on the next load.
+	void setReadAheadSamples(int numSamples) { readAheadSamples = juce::jmax(0, numSamples); }
+	int getReadAheadSamples() const { return readAheadSamples; }
+
+	// Blocks in which the read-ahead buffer had not caught up with playback
+	int getUnderrunCount() const { return underrunCount.load(); }
+	void resetUnderrunCount() { underrunCount.store(0); }
+
+	static constexpr int defaultReadAheadSamples = 65536;
+
+	// Audio thread: high-resolution ticks spent in each stage of this deck's
+	// rendering since the last call. Read after the deck has rendered, by
+	// whichever thread runs the mix.
+	struct StageTicks
+	{
+		juce::int64 source = 0;
+		juce::int64 stretch = 0;
+		juce::int64 eq = 0;
+		juce::int64 fade = 0;
+	};
+
+	StageTicks takeStageTicks() noexcept { return std::exchange(stageTicks, {}); }
+
+	// Low/mid/high EQ and high-pass/low-pass filters, before the fade
+	DeckEqualiser& getEqualiser() { return equaliser; }
+
+	// The deck's output levels, after the fade and volume
+	LevelMeasurement& getOutputLevels() { return outputLevels; }
+	SpectrumAnalyser& getSpectrumAnalyser() { return spectrumAnalyser; }
+
+	// Uncompressed WAV/AIFF files are memory-mapped and read in place instead of
+	// going through the read-ahead buffer. Takes effect on the next load.
+	void setMemoryMappingEnabled(bool shouldMap) { memoryMappingEnabled = shouldMap; }
+	bool isMemoryMappingEnabled() const { return memoryMappingEnabled; }
+	bool isMemoryMapped() const { return track != nullptr && track->isMemoryMapped(); }
+
+	static constexpr double prefetchWindowSeconds = 2.0;
+
+	// How long the output gain takes to move from silence to full scale
+	static constexpr double gainRampSeconds = 0.02;
 
 private:
 	bool muted = false;
-	bool isLooping = false;
 	bool paused = false;
 
+	// Also read by the audio thread, to hold off gapless transitions
+	std::atomic<bool> isLooping{ false };
+	std::atomic<bool> segmentLooping{ false };
+
 	double loopStart = 0.0;
 	double loopEnd = 0.0;
-	bool segmentLooping = false;
 	double playbackSpeed = 1.0;
+	TimeStretcher::Quality stretchQuality = TimeStretcher::Quality::Medium;
 	float currentGain = 0.7f;
 
 	// Fade settings
 	bool fadeInEnabled = true;
 	bool fadeOutEnabled = true;
-	int fadeSamples = 0;
-	int fadeCounter = 0;
-	static const int FADE_LENGTH_SAMPLES = 4410; // ~100ms at 44.1kHz
+	double fadeLengthMs = 100.0;
+	GainRamp::Curve fadeCurve = GainRamp::Curve::Linear;
+	GainRamp gainRamp;
+
+	// Fades are sent to the audio thread as commands, which it applies in
+	// order at the start of its next block, and report back through
+	// fadedOut. A stop, pause or seek is held until then and carried out by
+	// the timer.
+	enum class FadeCommand { FadeIn, FadeInFromSilence, FadeOut, Unity };
+	enum class PendingAction { None, Stop, Pause };
+
+	CommandQueue<FadeCommand, 64> fadeCommands;
+	std::atomic<bool> fadedOut{ false };
+
+	// The volume, or 0 while muted
+	SmoothedParameter outputGain{ 0.7f };
+	PendingAction pendingAction = PendingAction::None;
+	bool seekPending = false;
+	double pendingSeekPosition = 0.0;
 
 	juce::String currentFileName;
-
-	struct Metadata
-	{
-		juce::String title;
-		juce::String artist;
-		juce::String album;
-		double duration = 0.0;
-	} metadata;
-
-	juce::AudioFormatManager formatManager;
-	std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
-	juce::AudioTransportSource transportSource;
-
-	std::unique_ptr<juce::AudioThumbnailCache> thumbnailCache;
+	DeckTrack::Metadata metadata;
+
+	juce::SharedResourcePointer<SharedAudioFormats> formats;
+	juce::SharedResourcePointer<ReadAheadThread> readAheadThread;
+	juce::SharedResourcePointer<TrackLoaderPool> loaderPool;
+
+	// Owned and controlled by the message thread. The audio thread only reads
+	// it while holding trackLock, which the message thread takes just long
+	// enough to swap or rewire the track.
+	std::unique_ptr<DeckTrack> track;
+	juce::SpinLock trackLock;
+
+	// The queued track. Once the audio thread has switched over to it,
+	// nextTrackActive is set and it is the one playing until timerCallback
+	// moves it into 'track' on the message thread.
+	std::unique_ptr<DeckTrack> nextTrack;
+	std::atomic<bool> nextTrackActive{ false };
+	juce::File fileToQueueAfterLoad;
+	int queueGeneration = 0;
+
+	double crossfadeSeconds = 0.0;
+	std::atomic<int> crossfadeSamples{ 0 };
+	juce::AudioBuffer<float> transitionBuffer;
+
+	// The equal-power crossfade, sin(x * pi / 2) for x from 0 to 1, tabulated
+	// in prepareToPlay. Channel 0 of crossfadeGains holds the current track's
+	// gain for each sample of a chunk, channel 1 the next track's.
+	static constexpr int crossfadeCurveSize = 1024;
+	std::array<float, crossfadeCurveSize + 1> crossfadeCurve{};
+	juce::AudioBuffer<float> crossfadeGains;
+
+	StageTicks stageTicks;
+	DeckEqualiser equaliser;
+	LevelMeasurement outputLevels;
+
+	int readAheadSamples = defaultReadAheadSamples;
+	bool memoryMappingEnabled = true;
+	std::atomic<int> underrunCount{ 0 };
+	int blockSize = 0;
+	double deviceSampleRate = 0.0;
+
+	int loadGeneration = 0;
+	int numPendingLoads = 0;
+
+	juce::SharedResourcePointer<ThumbnailStore> thumbnailStore;
 	std::unique_ptr<juce::AudioThumbnail> thumbnail;
-
-	void applyFade(const juce::AudioSourceChannelInfo& bufferToFill);
+	juce::SharedResourcePointer<PeakPyramidThread> peakThread;
+	PeakPyramid peakPyramid{ *peakThread };
+	juce::SharedResourcePointer<SpectrumThread> spectrumThread;
+	SpectrumAnalyser spectrumAnalyser{ *spectrumThread };
+
+	void postFade(FadeCommand command);
+	void applyFade(FadeCommand command) noexcept;
+	bool canFadeOut() const;
+	void beginFadeOut();
+	void completePendingAction();
+	DeckTrack::Settings getTrackSettings() const;
+	void installTrack(std::unique_ptr<DeckTrack> newTrack);
+	void installNextTrack(std::unique_ptr<DeckTrack> newTrack);
+	void promoteNextTrack();
+
+	using TrackOpenedCallback = std::function<void(PlayerAudio&, std::unique_ptr<DeckTrack>)>;
+	void openTrackAsync(const juce::File& file, TrackOpenedCallback onOpened);
+	void prepareTrack(DeckTrack& trackToPrepare);
+
+	DeckTrack* getActiveTrack() const { return nextTrackActive.load() ? nextTrack.get() : track.get(); }
+	bool renderTransition(const juce::AudioSourceChannelInfo& bufferToFill);
+	float getCrossfadeGain(float x) const noexcept;
+	void timerCallback() override;
+
+	JUCE_DECLARE_WEAK_REFERENCEABLE(PlayerAudio)
 };
 
 // ==================== THEME MANAGER ====================
@@ -61,6 +61,54 @@ PlayerGUI::PlayerGUI(const juce::String& playerName)
 	speedSlider.addListener(this);
 	addAndMakeVisible(speedSlider);
 
+	stretchQualityBox.addItemList({ "Low", "Medium", "High" }, 1);
+	stretchQualityBox.setSelectedId((int)playerAudio.getTimeStretchQuality() + 1, juce::dontSendNotification);
+	stretchQualityBox.setTooltip("Time-stretch quality: higher sounds cleaner away from 1x and uses more CPU");
+	stretchQualityBox.onChange = [this]()
+		{
+			playerAudio.setTimeStretchQuality((TimeStretcher::Quality)(stretchQualityBox.getSelectedId() - 1));
+		};
+	addAndMakeVisible(stretchQualityBox);
+
+	for (auto* slider : { &lowEqSlider, &midEqSlider, &highEqSlider })
+	{
+		slider->setRange(DeckEqualiser::minimumGainDecibels, DeckEqualiser::maximumGainDecibels, 0.1);
+		slider->setValue(0.0, juce::dontSendNotification);
+		slider->setDoubleClickReturnValue(true, 0.0);
+		slider->setTextValueSuffix(" dB");
+	}
+
+	for (auto* slider : { &highPassSlider, &lowPassSlider })
+	{
+		slider->setRange(DeckEqualiser::minimumFrequency, DeckEqualiser::maximumFrequency, 1.0);
+		slider->setSkewFactorFromMidPoint(std::sqrt(DeckEqualiser::minimumFrequency * DeckEqualiser::maximumFrequency));
+		slider->setTextValueSuffix(" Hz");
+	}
+
+	// Each filter is off at its end of the range
+	highPassSlider.setValue(DeckEqualiser::minimumFrequency, juce::dontSendNotification);
+	highPassSlider.setDoubleClickReturnValue(true, DeckEqualiser::minimumFrequency);
+	lowPassSlider.setValue(DeckEqualiser::maximumFrequency, juce::dontSendNotification);
+	lowPassSlider.setDoubleClickReturnValue(true, DeckEqualiser::maximumFrequency);
+
+	const juce::StringArray eqNames{ "Low", "Mid", "High", "HP", "LP" };
+	const auto eqSliders = getEqSliders();
+
+	for (int i = 0; i < (int)eqSliders.size(); ++i)
+	{
+		auto* slider = eqSliders[(size_t)i];
+		slider->setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+		slider->setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+		slider->setPopupDisplayEnabled(true, true, this);
+		slider->addListener(this);
+		addAndMakeVisible(slider);
+
+		eqLabels[i].setText(eqNames[i], juce::dontSendNotification);
+		eqLabels[i].setJustificationType(juce::Justification::centred);
+		eqLabels[i].setFont(juce::Font(11.0f));
+		addAndMakeVisible(eqLabels[i]);
+	}
+
 	nameLabel.setText(name, juce::dontSendNotification);
 	nameLabel.setJustificationType(juce::Justification::centred);
 	nameLabel.setFont(juce::Font(16.0f, juce::Font::bold));
@@ -87,6 +135,16 @@ PlayerGUI::PlayerGUI(const juce::String& playerName)
 	addAndMakeVisible(metadataLabel);
 
 	addAndMakeVisible(waveformDisplay);
+	addAndMakeVisible(levelMeter);
+	addAndMakeVisible(spectrumDisplay);
+
+	playerAudio.onTrackChanged = [this]()
+		{
+			updateTrackLabels();
+
+			if (onTrackAdvanced != nullptr)
+				onTrackAdvanced();
+		};
 
 	applyThemeToComponents();
 	startTimerHz(10);
@@ -127,6 +185,19 @@ void PlayerGUI::applyThemeToComponents()
 	speedSlider.setColour(juce::Slider::thumbColourId, juce::Colour(0xff9b59b6));
 	speedSlider.setColour(juce::Slider::trackColourId, juce::Colour(0xff9b59b6));
 	speedSlider.setColour(juce::Slider::textBoxTextColourId, colors.text);
+	stretchQualityBox.setColour(juce::ComboBox::backgroundColourId, colors.secondaryBackground);
+	stretchQualityBox.setColour(juce::ComboBox::textColourId, colors.text);
+	stretchQualityBox.setColour(juce::ComboBox::outlineColourId, colors.border);
+
+	for (auto* slider : getEqSliders())
+	{
+		slider->setColour(juce::Slider::rotarySliderFillColourId, colors.sliderTrack);
+		slider->setColour(juce::Slider::rotarySliderOutlineColourId, colors.border);
+		slider->setColour(juce::Slider::thumbColourId, colors.sliderThumb);
+	}
+
+	for (auto& label : eqLabels)
+		label.setColour(juce::Label::textColourId, colors.textSecondary);
 
 	nameLabel.setColour(juce::Label::textColourId, colors.accent);
 	volumeLabel.setColour(juce::Label::textColourId, colors.text);
@@ -156,8 +227,14 @@ void PlayerGUI::resized()
 	metadataLabel.setBounds(area.removeFromTop(30));
 	area.removeFromTop(3);
 
-	waveformDisplay.setBounds(area.removeFromTop(60));
-	area.removeFromTop(5);
+	auto displayArea = area.removeFromTop(60);
+	spectrumDisplay.setBounds(displayArea.removeFromRight(displayArea.getWidth() / 3));
+	displayArea.removeFromRight(3);
+	waveformDisplay.setBounds(displayArea);
+	area.removeFromTop(3);
+
+	levelMeter.setBounds(area.removeFromTop(10));
+	area.removeFromTop(4);
 
 	auto posArea = area.removeFromTop(20);
 	back10sButton.setBounds(posArea.removeFromLeft(35));
@@ -200,28 +277,51 @@ void PlayerGUI::resized()
 
 	auto speedArea = area.removeFromTop(25);
 	speedLabel.setBounds(speedArea.removeFromLeft(45));
+	stretchQualityBox.setBounds(speedArea.removeFromRight(85));
+	speedArea.removeFromRight(3);
 	speedSlider.setBounds(speedArea);
+	area.removeFromTop(3);
+
+	auto eqArea = area.removeFromTop(52);
+	const auto eqSliders = getEqSliders();
+
+	for (int i = 0; i < (int)eqSliders.size(); ++i)
+	{
+		auto column = eqArea.removeFromLeft(55);
+		eqLabels[i].setBounds(column.removeFromBottom(14));
+		eqSliders[(size_t)i]->setBounds(column);
+		eqArea.removeFromLeft(i == 2 ? 15 : 3);
+	}
 }
 
-bool PlayerGUI::loadFile(const juce::File& file)
+void PlayerGUI::loadFile(const juce::File& file)
 {
-	if (playerAudio.loadFile(file))
-	{
-		fileNameLabel.setText(playerAudio.getFileName(), juce::dontSendNotification);
+	fileNameLabel.setText("Loading " + file.getFileNameWithoutExtension() + "...", juce::dontSendNotification);
+
+	playerAudio.loadFileAsync(file, [this](const PlayerAudio::LoadResult& result)
+		{
+			if (result.success)
+				updateTrackLabels();
+			else if (!playerAudio.isLoading())
+				fileNameLabel.setText(playerAudio.hasFileLoaded() ? playerAudio.getFileName() : "Could not load " + result.file.getFileName(),
+					juce::dontSendNotification);
+		});
+}
 
-		juce::String metadata;
-		if (playerAudio.getTitle() != playerAudio.getFileName())
-			metadata << "Title: " << playerAudio.getTitle() << "\n";
-		if (playerAudio.getArtist() != "Unknown Artist")
-			metadata << "Artist: " << playerAudio.getArtist();
+void PlayerGUI::updateTrackLabels()
+{
+	fileNameLabel.setText(playerAudio.getFileName(), juce::dontSendNotification);
 
-		if (metadata.isEmpty())
-			metadata = "No metadata";
+	juce::String metadata;
+	if (playerAudio.getTitle() != playerAudio.getFileName())
+		metadata << "Title: " << playerAudio.getTitle() << "\n";
+	if (playerAudio.getArtist() != "Unknown Artist")
+		metadata << "Artist: " << playerAudio.getArtist();
 
-		metadataLabel.setText(metadata, juce::dontSendNotification);
-		return true;
-	}
-	return false;
+	if (metadata.isEmpty())
+		metadata = "No metadata";
+
+	metadataLabel.setText(metadata, juce::dontSendNotification);
 }
 
 void PlayerGUI::buttonClicked(juce::Button* button)
@@ -286,6 +386,16 @@ void PlayerGUI::sliderValueChanged(juce::Slider* slider)
 		playerAudio.setPosition(slider->getValue() * playerAudio.getLength());
 	else if (slider == &speedSlider)
 		playerAudio.setPlaybackSpeed(speedSlider.getValue());
+	else if (slider == &lowEqSlider)
+		playerAudio.getEqualiser().setBandGainDecibels(DeckEqualiser::Band::Low, (float)slider->getValue());
+	else if (slider == &midEqSlider)
+		playerAudio.getEqualiser().setBandGainDecibels(DeckEqualiser::Band::Mid, (float)slider->getValue());
+	else if (slider == &highEqSlider)
+		playerAudio.getEqualiser().setBandGainDecibels(DeckEqualiser::Band::High, (float)slider->getValue());
+	else if (slider == &highPassSlider)
+		playerAudio.getEqualiser().setHighPassFrequency((float)slider->getValue());
+	else if (slider == &lowPassSlider)
+		playerAudio.getEqualiser().setLowPassFrequency((float)slider->getValue());
 }
 
 juce::String PlayerGUI::formatTime(double seconds)
@@ -1,12 +1,23 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PlayerAudio.h"
+#include "LevelMeter.h"
+#include "SpectrumDisplay.h"
 
+// Draws the deck's waveform from its peak pyramid. The mouse wheel zooms in
+// around the pointer, from the whole track down to one sample per pixel,
+// and a double-click zooms back out. While zoomed in the view pages along
+// with the playhead.
+//
+// The waveform is rendered once into an image, which is only redrawn when
+// the size, theme, track or view changes. Each timer tick repaints just the
+// strips the playhead is moving between.
 class WaveformDisplay : public juce::Component, public juce::Timer, public ThemeManager::Listener
 {
 public:
 	WaveformDisplay(PlayerAudio& player) : playerAudio(player)
 	{
+		setOpaque(true);
 		startTimerHz(30);
 		ThemeManager::getInstance().addListener(this);
 	}
@@ -18,51 +29,284 @@ public:
 
 	void themeChanged() override
 	{
-		repaint();
+		invalidateWaveform();
+	}
+
+	void resized() override
+	{
+		invalidateWaveform();
 	}
 
 	void paint(juce::Graphics& g) override
 	{
+		const auto startTicks = juce::Time::getHighResolutionTicks();
 		auto& colors = ThemeManager::getInstance().getColors();
 
-		g.fillAll(colors.background);
+		// Rendered at the display's pixel density so it stays sharp
+		const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+		const int imageWidth = juce::roundToInt((float)getWidth() * scale);
+		const int imageHeight = juce::roundToInt((float)getHeight() * scale);
 
-		auto bounds = getLocalBounds().reduced(2);
-		g.setColour(colors.secondaryBackground);
-		g.fillRect(bounds);
+		if (imageWidth <= 0 || imageHeight <= 0)
+			return;
 
-		juce::AudioThumbnail* thumbnail = playerAudio.getThumbnail();
-		if (thumbnail != nullptr && thumbnail->getTotalLength() > 0.0)
+		if (waveformDirty || waveformImage.getWidth() != imageWidth || waveformImage.getHeight() != imageHeight)
+			renderWaveformImage(imageWidth, imageHeight, scale);
+
+		g.drawImage(waveformImage, getLocalBounds().toFloat());
+
+		if (playheadX >= 0)
 		{
-			g.setColour(colors.waveform);
-			thumbnail->drawChannel(g, bounds, 0.0, thumbnail->getTotalLength(), 0, 0.8f);
+			const auto bounds = getLocalBounds().reduced(2);
+			g.setColour(colors.text);
+			g.drawLine((float)playheadX, (float)bounds.getY(), (float)playheadX, (float)bounds.getBottom(), 2.0f);
+		}
 
-			if (thumbnail->getNumChannels() > 1)
-			{
-				thumbnail->drawChannel(g, bounds, 0.0, thumbnail->getTotalLength(), 1, 0.8f);
-			}
+		if (showFrameTime)
+		{
+			g.setColour(colors.textSecondary);
+			g.setFont(11.0f);
+			g.drawText(juce::String(frameStats.averageMs, 3) + " ms avg, " + juce::String(frameStats.worstMs, 3) + " ms max",
+				getFrameTimeArea(), juce::Justification::centredRight, false);
+		}
+
+		recordFrameTime(startTicks);
+	}
+
+	void mouseWheelMove(const juce::MouseEvent& e, const juce::MouseWheelDetails& wheel) override
+	{
+		const double length = playerAudio.getLengthInSeconds();
+		const auto bounds = getLocalBounds().reduced(2);
+
+		if (length <= 0 || bounds.getWidth() <= 0)
+			return;
+
+		const auto range = getVisibleRange(length);
+		const double anchor = range.getStart() + range.getLength() * (e.position.x - (float)bounds.getX()) / bounds.getWidth();
 
-			double position = playerAudio.getCurrentPosition();
-			double length = playerAudio.getLengthInSeconds();
-			if (length > 0)
+		const double sampleRate = playerAudio.getPeakPyramid().getSampleRate();
+		const double shortest = juce::jmin(length, bounds.getWidth() / (sampleRate > 0.0 ? sampleRate : 44100.0));
+		const double newLength = juce::jlimit(shortest, length, range.getLength() * std::pow(2.0, -wheel.deltaY * 4.0));
+
+		visibleStart = anchor - (anchor - range.getStart()) * newLength / range.getLength();
+		visibleLength = newLength;
+		invalidateWaveform();
+	}
+
+	void mouseDoubleClick(const juce::MouseEvent&) override
+	{
+		visibleLength = 0.0;
+		invalidateWaveform();
+	}
+
+	void timerCallback() override
+	{
+		auto& pyramid = playerAudio.getPeakPyramid();
+
+		// A new track starts fully zoomed out
+		if (pyramid.getGeneration() != displayedGeneration)
+		{
+			displayedGeneration = pyramid.getGeneration();
+			visibleLength = 0.0;
+			invalidateWaveform();
+		}
+
+		// Pick up the pyramid as it fills in, a few times a second
+		if (!pyramid.isFullyBuilt() || !waveformComplete)
+		{
+			if (++ticksSinceRender >= 8)
+				invalidateWaveform();
+		}
+
+		const double length = playerAudio.getLengthInSeconds();
+
+		if (visibleLength > 0.0 && playerAudio.isPlaying())
+		{
+			const double position = playerAudio.getCurrentPosition();
+			if (position < visibleStart || position > visibleStart + visibleLength)
 			{
-				int xPos = bounds.getX() + (int)((position / length) * bounds.getWidth());
-				g.setColour(colors.text);
-				g.drawLine((float)xPos, (float)bounds.getY(), (float)xPos, (float)bounds.getBottom(), 2.0f);
+				visibleStart = position - visibleLength * 0.1;
+				invalidateWaveform();
 			}
 		}
 
-		g.setColour(colors.border);
-		g.drawRect(bounds, 1);
+		const int newPlayheadX = length > 0 ? getPlayheadX(length) : -1;
+
+		if (newPlayheadX != playheadX)
+		{
+			repaint(getPlayheadArea(playheadX));
+			playheadX = newPlayheadX;
+			repaint(getPlayheadArea(playheadX));
+		}
+
+		if (showFrameTime)
+			repaint(getFrameTimeArea());
 	}
 
-	void timerCallback() override
+	// Paint timings, for checking how much of the message thread the display
+	// uses. Ctrl+Shift+W shows them in the corner of each deck's waveform.
+	struct FrameStats
+	{
+		juce::int64 numFrames = 0;
+		double lastMs = 0.0;
+		double averageMs = 0.0;
+		double worstMs = 0.0;
+	};
+
+	const FrameStats& getFrameStats() const { return frameStats; }
+	void resetFrameStats() { frameStats = {}; }
+
+	void setShowFrameTime(bool shouldShow)
 	{
+		showFrameTime = shouldShow;
 		repaint();
 	}
 
+	bool isShowingFrameTime() const { return showFrameTime; }
+
 private:
 	PlayerAudio& playerAudio;
+
+	// In seconds. A length of 0 shows the whole track.
+	double visibleStart = 0.0;
+	double visibleLength = 0.0;
+	int displayedGeneration = -1;
+
+	juce::Image waveformImage;
+	bool waveformDirty = true;
+	bool waveformComplete = false;
+	int ticksSinceRender = 0;
+	int playheadX = -1;
+
+	std::vector<PeakPyramid::Peak> peaks;
+
+	FrameStats frameStats;
+	bool showFrameTime = false;
+
+	void invalidateWaveform()
+	{
+		waveformDirty = true;
+		repaint();
+	}
+
+	juce::Range<double> getVisibleRange(double length) const
+	{
+		if (visibleLength <= 0.0 || visibleLength >= length)
+			return { 0.0, length };
+
+		const double start = juce::jlimit(0.0, length - visibleLength, visibleStart);
+		return { start, start + visibleLength };
+	}
+
+	int getPlayheadX(double length) const
+	{
+		const auto range = getVisibleRange(length);
+		const double position = playerAudio.getCurrentPosition();
+
+		if (!range.contains(position))
+			return -1;
+
+		const auto bounds = getLocalBounds().reduced(2);
+		return bounds.getX() + (int)((position - range.getStart()) / range.getLength() * bounds.getWidth());
+	}
+
+	juce::Rectangle<int> getPlayheadArea(int x) const
+	{
+		return x < 0 ? juce::Rectangle<int>() : juce::Rectangle<int>(x - 2, 0, 4, getHeight());
+	}
+
+	juce::Rectangle<int> getFrameTimeArea() const
+	{
+		return getLocalBounds().reduced(4).removeFromTop(14).removeFromRight(160);
+	}
+
+	void recordFrameTime(juce::int64 startTicks)
+	{
+		const double ms = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+
+		++frameStats.numFrames;
+		frameStats.lastMs = ms;
+		frameStats.averageMs += (ms - frameStats.averageMs) / (double)frameStats.numFrames;
+		frameStats.worstMs = juce::jmax(frameStats.worstMs, ms);
+	}
+
+	void renderWaveformImage(int imageWidth, int imageHeight, float scale)
+	{
+		auto& colors = ThemeManager::getInstance().getColors();
+
+		if (waveformImage.getWidth() != imageWidth || waveformImage.getHeight() != imageHeight)
+			waveformImage = juce::Image(juce::Image::RGB, imageWidth, imageHeight, false);
+
+		juce::Graphics g(waveformImage);
+		g.addTransform(juce::AffineTransform::scale(scale));
+
+		g.fillAll(colors.background);
+
+		auto bounds = getLocalBounds().reduced(2);
+		g.setColour(colors.secondaryBackground);
+		g.fillRect(bounds);
+
+		const double length = playerAudio.getLengthInSeconds();
+		waveformComplete = length <= 0 || drawWaveform(g, bounds, getVisibleRange(length), colors);
+
+		g.setColour(colors.border);
+		g.drawRect(bounds, 1);
+
+		waveformDirty = false;
+		ticksSinceRender = 0;
+	}
+
+	// Returns false if part of the view still has to be filled in later
+	bool drawWaveform(juce::Graphics& g, juce::Rectangle<int> bounds, juce::Range<double> range, const ThemeManager::ColorScheme& colors)
+	{
+		auto& pyramid = playerAudio.getPeakPyramid();
+		const int width = bounds.getWidth();
+		int numDrawn = 0;
+
+		if (pyramid.getSampleRate() > 0.0 && width > 0)
+		{
+			peaks.resize((size_t)width);
+			numDrawn = pyramid.getPeaks((juce::int64)(range.getStart() * pyramid.getSampleRate()),
+				(juce::int64)(range.getEnd() * pyramid.getSampleRate()), peaks.data(), width);
+		}
+
+		// Peak envelope with the RMS level drawn brighter inside it
+		const float centreY = (float)bounds.getCentreY();
+		const float halfHeight = bounds.getHeight() * 0.5f * 0.8f;
+		juce::RectangleList<float> envelope, body;
+
+		for (int x = 0; x < numDrawn; ++x)
+		{
+			const auto& peak = peaks[(size_t)x];
+			const float left = (float)(bounds.getX() + x);
+			envelope.addWithoutMerging({ left, centreY - peak.max * halfHeight, 1.0f, juce::jmax(1.0f, (peak.max - peak.min) * halfHeight) });
+			body.addWithoutMerging({ left, centreY - peak.rms * halfHeight, 1.0f, juce::jmax(1.0f, 2.0f * peak.rms * halfHeight) });
+		}
+
+		g.setColour(colors.waveform);
+		g.fillRectList(envelope);
+		g.setColour(colors.waveform.brighter(0.5f));
+		g.fillRectList(body);
+
+		if (numDrawn >= width)
+			return true;
+
+		if (pyramid.isFullyBuilt())
+			return !pyramid.isDecodingSamples();
+
+		// Whatever the pyramid hasn't reached yet comes from the stored thumbnail
+		juce::AudioThumbnail* thumbnail = playerAudio.getThumbnail();
+		if (thumbnail != nullptr && thumbnail->getTotalLength() > 0.0)
+		{
+			const double restStart = range.getStart() + range.getLength() * numDrawn / width;
+			g.setColour(colors.waveform);
+
+			for (int channel = 0; channel < juce::jmin(2, thumbnail->getNumChannels()); ++channel)
+				thumbnail->drawChannel(g, bounds.withTrimmedLeft(numDrawn), restStart, range.getEnd(), channel, 0.8f);
+		}
+
+		return false;
+	}
 };
 
 class PlayerGUI : public juce::Component,
@@ -83,13 +327,20 @@ public:
 	void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
 	void releaseResources();
 
-	bool loadFile(const juce::File& file);
+	// Loads in the background; the labels update once the track is swapped in
+	void loadFile(const juce::File& file);
 	PlayerAudio& getPlayerAudio() { return playerAudio; }
+	WaveformDisplay& getWaveformDisplay() { return waveformDisplay; }
+
+	// Called after the deck has moved on to its queued track by itself
+	std::function<void()> onTrackAdvanced;
 
 private:
 	juce::String name;
 	PlayerAudio playerAudio;
 	WaveformDisplay waveformDisplay;
+	LevelMeter levelMeter{ playerAudio.getOutputLevels() };
+	SpectrumDisplay spectrumDisplay{ playerAudio.getSpectrumAnalyser() };
 
 	juce::TextButton playButton{ "Play" };
 	juce::TextButton pauseButton{ "Pause" };
@@ -110,6 +361,20 @@ private:
 	juce::Slider positionSlider;
 	juce::Slider speedSlider;
 
+	// Time-stretch quality, trading CPU for fewer artefacts away from 1x.
+	// Item IDs are the TimeStretcher::Quality values plus one.
+	juce::ComboBox stretchQualityBox;
+
+	// Low, mid and high EQ gains, then the high-pass and low-pass cutoffs
+	juce::Slider lowEqSlider;
+	juce::Slider midEqSlider;
+	juce::Slider highEqSlider;
+	juce::Slider highPassSlider;
+	juce::Slider lowPassSlider;
+	juce::Label eqLabels[5];
+
+	std::array<juce::Slider*, 5> getEqSliders() { return { &lowEqSlider, &midEqSlider, &highEqSlider, &highPassSlider, &lowPassSlider }; }
+
 	juce::Label nameLabel;
 	juce::Label timeLabel;
 	juce::Label fileNameLabel;
@@ -124,6 +389,7 @@ private:
 	void sliderValueChanged(juce::Slider* slider) override;
 	void timerCallback() override;
 	juce::String formatTime(double seconds);
+	void updateTrackLabels();
 	void styleButton(juce::TextButton& button, juce::Colour colour);
 	void applyThemeToComponents();
 
@@ -0,0 +1,220 @@
+#include "PlaylistSearch.h"
+
+namespace
+{
+	// Trigrams and word prefixes share one table, told apart by the top byte
+	constexpr juce::uint32 makeGram(const char* text, int length) noexcept
+	{
+		juce::uint32 gram = (juce::uint32)length << 24;
+
+		for (int i = 0; i < length; ++i)
+			gram |= (juce::uint32)(unsigned char)text[i] << (8 * i);
+
+		return gram;
+	}
+}
+
+void PlaylistSearchIndex::setTrack(int index, const LibraryIndex::Entry& entry)
+{
+	jassert(index >= 0 && index <= getNumTracks());
+
+	if (index == getNumTracks())
+	{
+		keys.push_back(makeKey(entry));
+
+		if (!isTimerRunning())
+			startTimer(10);
+
+		return;
+	}
+
+	if (index < numIndexed)
+		removePostings(index);
+
+	keys[(size_t)index] = makeKey(entry);
+
+	if (index < numIndexed)
+		addPostings(index);
+}
+
+void PlaylistSearchIndex::clear()
+{
+	stopTimer();
+	keys.clear();
+	postings.clear();
+	numIndexed = 0;
+}
+
+void PlaylistSearchIndex::search(const juce::String& query, std::vector<int>& matchingTracks)
+{
+	matchingTracks.clear();
+	indexPendingTracks(getNumTracks());
+
+	std::vector<std::string> terms;
+
+	for (const auto& token : juce::StringArray::fromTokens(query.toLowerCase(), true))
+		if (token.isNotEmpty())
+			terms.push_back(token.toStdString());
+
+	if (terms.empty())
+		return;
+
+	// A word prefix or a three-character term is matched exactly by its own
+	// posting list. Longer terms are narrowed down by all of their trigrams
+	// and then checked against the key.
+	std::vector<const std::vector<int>*> lists;
+	bool needsCheck = false;
+
+	for (const auto& term : terms)
+	{
+		const int gramLength = juce::jmin(3, (int)term.size());
+
+		for (size_t i = 0; i + (size_t)gramLength <= term.size(); ++i)
+		{
+			const auto found = postings.find(makeGram(term.data() + i, gramLength));
+
+			if (found == postings.end())
+				return;
+
+			lists.push_back(&found->second);
+
+			if (gramLength < 3)
+				break;
+		}
+
+		needsCheck = needsCheck || term.size() > 3;
+	}
+
+	std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+	matchingTracks = *lists.front();
+
+	for (size_t i = 1; i < lists.size() && !matchingTracks.empty(); ++i)
+		intersect(matchingTracks, *lists[i]);
+
+	if (!needsCheck)
+		return;
+
+	const auto unmatched = std::remove_if(matchingTracks.begin(), matchingTracks.end(), [&](int index)
+		{
+			const auto& key = keys[(size_t)index];
+
+			for (const auto& term : terms)
+				if (term.size() > 3 && key.find(term) == std::string::npos)
+					return true;
+
+			return false;
+		});
+
+	matchingTracks.erase(unmatched, matchingTracks.end());
+}
+
+void PlaylistSearchIndex::intersect(std::vector<int>& tracks, const std::vector<int>& list)
+{
+	auto out = tracks.begin();
+	auto next = list.begin();
+
+	// tracks is the shorter list. Walk both together when they're of a
+	// similar size, otherwise binary search through the longer one.
+	const bool skip = list.size() > tracks.size() * 8;
+
+	for (const int index : tracks)
+	{
+		if (skip)
+			next = std::lower_bound(next, list.end(), index);
+		else
+			while (next != list.end() && *next < index)
+				++next;
+
+		if (next == list.end())
+			break;
+
+		if (*next == index)
+			*out++ = index;
+	}
+
+	tracks.erase(out, tracks.end());
+}
+
+void PlaylistSearchIndex::indexPendingTracks(int maxTracks)
+{
+	const int end = juce::jmin(getNumTracks(), numIndexed + maxTracks);
+
+	for (; numIndexed < end; ++numIndexed)
+		addPostings(numIndexed);
+}
+
+void PlaylistSearchIndex::timerCallback()
+{
+	indexPendingTracks(tracksPerSlice);
+
+	if (numIndexed == getNumTracks())
+		stopTimer();
+}
+
+void PlaylistSearchIndex::addPostings(int index)
+{
+	collectGrams(keys[(size_t)index], grams);
+
+	for (const auto gram : grams)
+	{
+		auto& list = postings[gram];
+
+		// Tracks are mostly indexed in order, so this is nearly always an append
+		if (list.empty() || list.back() < index)
+			list.push_back(index);
+		else
+			list.insert(std::lower_bound(list.begin(), list.end(), index), index);
+	}
+}
+
+void PlaylistSearchIndex::removePostings(int index)
+{
+	collectGrams(keys[(size_t)index], grams);
+
+	for (const auto gram : grams)
+	{
+		auto& list = postings[gram];
+		const auto found = std::lower_bound(list.begin(), list.end(), index);
+
+		if (found != list.end() && *found == index)
+			list.erase(found);
+	}
+}
+
+std::string PlaylistSearchIndex::makeKey(const LibraryIndex::Entry& entry)
+{
+	juce::String key;
+	key << entry.title << fieldSeparator << entry.artist << fieldSeparator << entry.file.getFileName();
+	return key.toLowerCase().toStdString();
+}
+
+void PlaylistSearchIndex::collectGrams(const std::string& key, std::vector<juce::uint32>& grams)
+{
+	grams.clear();
+
+	for (size_t i = 0; i < key.size(); ++i)
+	{
+		if (i + 3 <= key.size() && key[i] != fieldSeparator && key[i + 1] != fieldSeparator && key[i + 2] != fieldSeparator)
+			grams.push_back(makeGram(key.data() + i, 3));
+
+		const bool startsWord = isWordChar((unsigned char)key[i]) && (i == 0 || !isWordChar((unsigned char)key[i - 1]));
+
+		if (startsWord)
+		{
+			grams.push_back(makeGram(key.data() + i, 1));
+
+			if (i + 1 < key.size() && isWordChar((unsigned char)key[i + 1]))
+				grams.push_back(makeGram(key.data() + i, 2));
+		}
+	}
+
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+bool PlaylistSearchIndex::isWordChar(unsigned char c) noexcept
+{
+	// Bytes of multi-byte UTF-8 characters count as letters
+	return c >= 0x80 || std::isalnum(c);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <JuceHeader.h>
+#include "LibraryIndex.h"
+
+// ==================== PLAYLIST SEARCH ====================
+
+// As-you-type search over the playlist's titles, artists and file names.
+// A query is split into words and a track has to match all of them. Words
+// of three or more characters match anywhere, looked up through an index of
+// every three-character sequence in each track. Shorter words match the
+// start of a word, through an index of one and two character word prefixes.
+//
+// Adding a track only stores its lowercase key. The index itself is built
+// in small slices on the message thread's timer, so a large playlist never
+// stalls the UI; a search that comes in first finishes the job itself.
+class PlaylistSearchIndex : private juce::Timer
+{
+public:
+	static constexpr int tracksPerSlice = 2000;
+
+	// index may be one past the last track, to add a track
+	void setTrack(int index, const LibraryIndex::Entry& entry);
+	void clear();
+	int getNumTracks() const { return (int)keys.size(); }
+
+	// Fills matchingTracks with the indices of every matching track, in order
+	void search(const juce::String& query, std::vector<int>& matchingTracks);
+
+private:
+	// Title, artist and file name, lowercased and separated by fieldSeparator
+	std::vector<std::string> keys;
+	int numIndexed = 0;
+
+	// Sorted track indices for each trigram or word prefix
+	std::unordered_map<juce::uint32, std::vector<int>> postings;
+	std::vector<juce::uint32> grams;
+
+	static constexpr char fieldSeparator = '\x01';
+
+	void indexPendingTracks(int maxTracks);
+	void timerCallback() override;
+	static void intersect(std::vector<int>& tracks, const std::vector<int>& list);
+	void addPostings(int index);
+	void removePostings(int index);
+
+	static std::string makeKey(const LibraryIndex::Entry& entry);
+	static void collectGrams(const std::string& key, std::vector<juce::uint32>& grams);
+	static bool isWordChar(unsigned char c) noexcept;
+};
@@ -0,0 +1,244 @@
+#include "ProfilerOverlay.h"
+
+ProfilerOverlay::ProfilerOverlay(AudioProfiler& profilerToShow, juce::AudioDeviceManager& deviceManagerToUse, MasterLimiter& limiterToShow,
+	const DeckMixer& mixerToShow)
+	: profiler(profilerToShow), deviceManager(deviceManagerToUse), limiter(limiterToShow), mixer(mixerToShow)
+{
+	logButton.onClick = [this]() { setLogging(logButton.getToggleState()); };
+	addAndMakeVisible(logButton);
+
+	resetButton.onClick = [this]()
+		{
+			profiler.resetCounters();
+			deviceXRunsAtReset = deviceManager.getXRunCount();
+			repaint();
+		};
+	addAndMakeVisible(resetButton);
+
+	deviceXRunsAtReset = deviceManager.getXRunCount();
+}
+
+ProfilerOverlay::~ProfilerOverlay()
+{
+	setLogging(false);
+	profiler.setRecordsEnabled(false);
+}
+
+void ProfilerOverlay::setLogging(bool shouldLog)
+{
+	if (shouldLog == isLogging())
+		return;
+
+	if (shouldLog)
+	{
+		logFile = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+			.getNonexistentChildFile("audio-profile-" + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S"), ".csv");
+
+		logStream = std::make_unique<juce::FileOutputStream>(logFile, 1 << 16);
+
+		if (logStream->failedToOpen())
+			logStream.reset();
+		else
+		{
+			numLoggedDecks = mixer.getNumDecks();
+			*logStream << AudioProfiler::getCsvHeader(numLoggedDecks) << '\n';
+		}
+	}
+	else
+	{
+		// Whatever is still in the ring belongs in the log
+		timerCallback();
+		logStream.reset();
+	}
+
+	logButton.setToggleState(isLogging(), juce::dontSendNotification);
+	updateRunning();
+}
+
+void ProfilerOverlay::visibilityChanged()
+{
+	updateRunning();
+}
+
+void ProfilerOverlay::updateRunning()
+{
+	// Records are only worth making while someone reads them
+	const bool running = isVisible() || isLogging();
+	profiler.setRecordsEnabled(running);
+
+	if (running && !isTimerRunning())
+		startTimer(250);
+	else if (!running)
+		stopTimer();
+}
+
+void ProfilerOverlay::timerCallback()
+{
+	Summary next;
+	double totalMs = 0.0;
+	double totalPercent = 0.0;
+
+	profiler.readRecords([&](const AudioProfiler::Record& record)
+		{
+			++next.numRecords;
+			totalMs += record.callbackMs;
+			totalPercent += record.budgetPercent;
+			next.worstMs = juce::jmax(next.worstMs, record.callbackMs);
+			next.worstPercent = juce::jmax(next.worstPercent, record.budgetPercent);
+			next.numDecks = juce::jmax(next.numDecks, record.numDecks);
+
+			for (int d = 0; d < record.numDecks; ++d)
+			{
+				next.decks[d].sourceMs += record.decks[d].sourceMs;
+				next.decks[d].stretchMs += record.decks[d].stretchMs;
+				next.decks[d].eqMs += record.decks[d].eqMs;
+				next.decks[d].fadeMs += record.decks[d].fadeMs;
+			}
+
+			if (logStream != nullptr)
+				AudioProfiler::writeCsvLine(*logStream, record, numLoggedDecks);
+		});
+
+	if (next.numRecords > 0)
+	{
+		const float count = (float)next.numRecords;
+		next.averageMs = (float)(totalMs / count);
+		next.averagePercent = (float)(totalPercent / count);
+
+		for (int d = 0; d < next.numDecks; ++d)
+		{
+			next.decks[d].sourceMs /= count;
+			next.decks[d].stretchMs /= count;
+			next.decks[d].eqMs /= count;
+			next.decks[d].fadeMs /= count;
+		}
+
+		summary = next;
+	}
+
+	summary.limiterReductionDb = limiter.takeMaxGainReductionDecibels();
+
+	if (isVisible())
+		repaint();
+}
+
+void ProfilerOverlay::resized()
+{
+	auto buttons = getLocalBounds().reduced(6).removeFromTop(22);
+	resetButton.setBounds(buttons.removeFromRight(60));
+	buttons.removeFromRight(5);
+	logButton.setBounds(buttons.removeFromRight(80));
+}
+
+void ProfilerOverlay::paint(juce::Graphics& g)
+{
+	auto& colors = ThemeManager::getInstance().getColors();
+
+	g.setColour(colors.secondaryBackground.withAlpha(0.92f));
+	g.fillRoundedRectangle(getLocalBounds().toFloat(), 6.0f);
+	g.setColour(colors.border);
+	g.drawRoundedRectangle(getLocalBounds().toFloat().reduced(0.5f), 6.0f, 1.0f);
+
+	auto area = getLocalBounds().reduced(8, 6);
+	const int lineHeight = 16;
+
+	g.setColour(colors.accent);
+	g.setFont(juce::Font(13.0f, juce::Font::bold));
+	g.drawText("AUDIO THREAD", area.removeFromTop(22), juce::Justification::centredLeft, false);
+
+	g.setColour(colors.text);
+	g.setFont(12.0f);
+
+	auto drawLine = [&](const juce::String& text)
+		{
+			g.drawText(text, area.removeFromTop(lineHeight), juce::Justification::centredLeft, true);
+		};
+
+	drawLine("Callback " + juce::String(summary.averageMs, 3) + " ms avg, " + juce::String(summary.worstMs, 3) + " ms worst");
+	drawLine("Block used " + juce::String(summary.averagePercent, 1) + "% avg, " + juce::String(summary.worstPercent, 1) + "% worst");
+	drawLine("Overruns " + juce::String(profiler.getNumOverruns()) + ", late callbacks " + juce::String(profiler.getNumLateCallbacks())
+		+ ", device xruns " + juce::String(deviceManager.getXRunCount() - deviceXRunsAtReset));
+
+	drawLine("Limiter " + juce::String(summary.limiterReductionDb, 1) + " dB reduction, "
+		+ juce::String(limiter.getLatencyMs(), 2) + " ms latency" + (limiter.isSoftClipEnabled() ? ", soft clip" : ""));
+
+	const int numDeckLines = summary.numDecks > maxDeckLines ? maxDeckLines - 1 : summary.numDecks;
+
+	for (int d = 0; d < numDeckLines; ++d)
+	{
+		const auto& deck = summary.decks[d];
+		drawLine("Deck " + juce::String(d + 1) + ": source " + juce::String(deck.sourceMs, 3) + ", stretch "
+			+ juce::String(deck.stretchMs, 3) + ", eq " + juce::String(deck.eqMs, 3) + ", fade " + juce::String(deck.fadeMs, 3) + " ms");
+	}
+
+	if (numDeckLines < summary.numDecks)
+	{
+		float restMs = 0.0f;
+
+		for (int d = numDeckLines; d < summary.numDecks; ++d)
+			restMs += summary.decks[d].sourceMs + summary.decks[d].stretchMs + summary.decks[d].eqMs + summary.decks[d].fadeMs;
+
+		drawLine("Decks " + juce::String(numDeckLines + 1) + "-" + juce::String(summary.numDecks) + ": "
+			+ juce::String(restMs, 3) + " ms in total");
+	}
+
+	if (const int dropped = profiler.getNumDroppedRecords(); dropped > 0)
+	{
+		g.setColour(colors.textSecondary);
+		drawLine(juce::String(dropped) + " records dropped");
+	}
+
+	if (isLogging())
+	{
+		g.setColour(colors.textSecondary);
+		drawLine("Logging to " + logFile.getFileName());
+	}
+
+	area.removeFromTop(4);
+	drawHistogram(g, area);
+}
+
+void ProfilerOverlay::drawHistogram(juce::Graphics& g, juce::Rectangle<int> area)
+{
+	auto& colors = ThemeManager::getInstance().getColors();
+
+	auto labels = area.removeFromBottom(14);
+
+	if (area.getHeight() < 10)
+		return;
+
+	int counts[AudioProfiler::numHistogramBins];
+	int maxCount = 1;
+
+	for (int bin = 0; bin < AudioProfiler::numHistogramBins; ++bin)
+	{
+		counts[bin] = profiler.getHistogramCount(bin);
+		maxCount = juce::jmax(maxCount, counts[bin]);
+	}
+
+	const float binWidth = (float)area.getWidth() / (float)AudioProfiler::numHistogramBins;
+	const float logMax = std::log1p((float)maxCount);
+
+	// Bars on a log scale, so the rare slow callbacks are still visible next
+	// to the common fast ones. Anything past the block's length is in red.
+	for (int bin = 0; bin < AudioProfiler::numHistogramBins; ++bin)
+	{
+		if (counts[bin] == 0)
+			continue;
+
+		const float height = (float)area.getHeight() * std::log1p((float)counts[bin]) / logMax;
+		const bool over = bin * AudioProfiler::histogramBinPercent >= 100;
+
+		g.setColour(over ? colors.stopButton : colors.waveform);
+		g.fillRect((float)area.getX() + bin * binWidth, (float)area.getBottom() - height, juce::jmax(1.0f, binWidth - 1.0f), height);
+	}
+
+	const float fullBlockX = (float)area.getX() + (100.0f / AudioProfiler::histogramBinPercent) * binWidth;
+	g.setColour(colors.textSecondary);
+	g.drawVerticalLine(juce::roundToInt(fullBlockX), (float)area.getY(), (float)area.getBottom());
+
+	g.setFont(10.0f);
+	g.drawText("0%", labels.removeFromLeft(30), juce::Justification::centredLeft, false);
+	g.drawText("100%", juce::Rectangle<int>(juce::roundToInt(fullBlockX) - 15, labels.getY(), 30, labels.getHeight()), juce::Justification::centred, false);
+	g.drawText("200%+", labels.removeFromRight(40), juce::Justification::centredRight, false);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AudioProfiler.h"
+#include "MasterLimiter.h"
+#include "PlayerAudio.h"
+
+// ==================== PROFILER OVERLAY ====================
+
+// Shows the audio profiler's figures on top of the decks: callback times and
+// each deck's stages over the last quarter second, the histogram of callback
+// times, the overrun, late-callback and device xrun counts, and the master
+// limiter's latency and gain reduction. It can also
+// write every callback to a CSV file in the user's documents folder.
+class ProfilerOverlay : public juce::Component,
+	private juce::Timer
+{
+public:
+	ProfilerOverlay(AudioProfiler& profilerToShow, juce::AudioDeviceManager& deviceManagerToUse, MasterLimiter& limiterToShow,
+		const DeckMixer& mixerToShow);
+	~ProfilerOverlay() override;
+
+	void paint(juce::Graphics& g) override;
+	void resized() override;
+	void visibilityChanged() override;
+
+	void setLogging(bool shouldLog);
+	bool isLogging() const { return logStream != nullptr; }
+	juce::File getLogFile() const { return logFile; }
+
+private:
+	AudioProfiler& profiler;
+	juce::AudioDeviceManager& deviceManager;
+	MasterLimiter& limiter;
+	const DeckMixer& mixer;
+
+	juce::ToggleButton logButton{ "Log CSV" };
+	juce::TextButton resetButton{ "Reset" };
+
+	// The records read on the last timer tick
+	struct Summary
+	{
+		int numRecords = 0;
+		float averageMs = 0.0f;
+		float worstMs = 0.0f;
+		float averagePercent = 0.0f;
+		float worstPercent = 0.0f;
+		int numDecks = 0;
+		AudioProfiler::DeckTimes decks[AudioProfiler::maxDecks];
+		float limiterReductionDb = 0.0f;
+	};
+
+	Summary summary;
+	int deviceXRunsAtReset = 0;
+
+	std::unique_ptr<juce::FileOutputStream> logStream;
+	juce::File logFile;
+
+	// The log has columns for the decks there were when it started
+	int numLoggedDecks = 0;
+
+	// Beyond this many, decks are summed into one line
+	static constexpr int maxDeckLines = 4;
+
+	void timerCallback() override;
+	void updateRunning();
+	void drawHistogram(juce::Graphics& g, juce::Rectangle<int> area);
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProfilerOverlay)
+};
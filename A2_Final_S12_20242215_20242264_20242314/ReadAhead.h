@@ -0,0 +1,136 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== READ-AHEAD ====================
+
+// One background thread shared by every deck (via juce::SharedResourcePointer)
+// that keeps the decks' read-ahead buffers topped up.
+class ReadAheadThread : public juce::TimeSliceThread
+{
+public:
+	ReadAheadThread() : juce::TimeSliceThread("Deck Read-Ahead")
+	{
+		startThread(juce::Thread::Priority::high);
+	}
+
+	~ReadAheadThread() override
+	{
+		stopThread(2000);
+	}
+};
+
+// Sits between the file reader and the BufferingAudioSource and records which
+// range the background thread has decoded so far, so the audio thread can
+// detect an underrun without taking the buffer's lock.
+class ReadAheadMonitor : public juce::PositionableAudioSource
+{
+public:
+	explicit ReadAheadMonitor(juce::PositionableAudioSource& sourceToMonitor)
+		: source(sourceToMonitor)
+	{
+	}
+
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override
+	{
+		source.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	}
+
+	void releaseResources() override
+	{
+		source.releaseResources();
+	}
+
+	// Called on the read-ahead thread
+	void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override
+	{
+		const auto start = source.getNextReadPosition();
+		source.getNextAudioBlock(info);
+
+		if (start != filledEnd.load(std::memory_order_relaxed))
+			filledStart.store(start, std::memory_order_relaxed);
+
+		filledEnd.store(start + info.numSamples, std::memory_order_release);
+	}
+
+	void setNextReadPosition(juce::int64 newPosition) override { source.setNextReadPosition(newPosition); }
+	juce::int64 getNextReadPosition() const override { return source.getNextReadPosition(); }
+	juce::int64 getTotalLength() const override { return source.getTotalLength(); }
+	bool isLooping() const override { return source.isLooping(); }
+	void setLooping(bool shouldLoop) override { source.setLooping(shouldLoop); }
+
+	// Audio thread: true if [start, start + numSamples) has already been decoded
+	bool isRangeReady(juce::int64 start, int numSamples) const noexcept
+	{
+		if (source.isLooping() || start >= source.getTotalLength())
+			return true;
+
+		const auto end = filledEnd.load(std::memory_order_acquire);
+		return start >= filledStart.load(std::memory_order_relaxed)
+			&& juce::jmin(start + numSamples, source.getTotalLength()) <= end;
+	}
+
+private:
+	juce::PositionableAudioSource& source;
+	std::atomic<juce::int64> filledStart{ 0 };
+	std::atomic<juce::int64> filledEnd{ 0 };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReadAheadMonitor)
+};
+
+// Keeps the pages of a memory-mapped file resident around the play head and
+// around the start of the A-B loop, so reads from the audio thread (and loop
+// wraps) are served from memory instead of faulting in from disk.
+class MappedReaderPrefetcher : public juce::TimeSliceClient
+{
+public:
+	static constexpr int pageSizeBytes = 4096;
+	static constexpr int intervalMs = 20;
+
+	MappedReaderPrefetcher(juce::MemoryMappedAudioFormatReader& readerToPrefetch, juce::int64 windowSamples)
+		: reader(readerToPrefetch), window(windowSamples),
+		samplesPerPage(juce::jmax<juce::int64>(1, pageSizeBytes / juce::jmax(1, (int)(reader.numChannels * reader.bitsPerSample / 8))))
+	{
+	}
+
+	void setPlayPosition(juce::int64 sample) noexcept { playPosition.store(sample, std::memory_order_relaxed); }
+
+	void setLoopRange(juce::int64 startSample, juce::int64 endSample) noexcept
+	{
+		loopStart.store(startSample, std::memory_order_relaxed);
+		loopEnd.store(endSample, std::memory_order_relaxed);
+	}
+
+	void clearLoopRange() noexcept { setLoopRange(0, 0); }
+
+	// Faults in the pages for [startSample, startSample + window) on the
+	// calling thread
+	void touchAround(juce::int64 startSample) const noexcept
+	{
+		const auto end = juce::jmin(startSample + window, reader.lengthInSamples);
+
+		for (auto sample = juce::jmax<juce::int64>(0, startSample); sample < end; sample += samplesPerPage)
+			reader.touchSample(sample);
+	}
+
+	int useTimeSlice() override
+	{
+		touchAround(playPosition.load(std::memory_order_relaxed));
+
+		const auto start = loopStart.load(std::memory_order_relaxed);
+		if (start < loopEnd.load(std::memory_order_relaxed))
+			touchAround(start);
+
+		return intervalMs;
+	}
+
+private:
+	juce::MemoryMappedAudioFormatReader& reader;
+	const juce::int64 window;
+	const juce::int64 samplesPerPage;
+
+	std::atomic<juce::int64> playPosition{ 0 };
+	std::atomic<juce::int64> loopStart{ 0 };
+	std::atomic<juce::int64> loopEnd{ 0 };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedReaderPrefetcher)
+};
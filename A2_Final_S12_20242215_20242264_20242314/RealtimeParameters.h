@@ -0,0 +1,99 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== REALTIME PARAMETERS ====================
+
+// A level set from the message thread and applied by the audio thread. The
+// audio thread only ever reads the latest value from an atomic, and moves
+// towards it at a limited rate, ramping across each block so that a slider
+// drag or a mute doesn't click.
+class SmoothedParameter
+{
+public:
+	explicit SmoothedParameter(float initialValue = 0.0f) noexcept
+		: target(initialValue), current(initialValue)
+	{
+	}
+
+	// Any thread
+	void set(float newValue) noexcept { target.store(newValue, std::memory_order_relaxed); }
+	float get() const noexcept { return target.load(std::memory_order_relaxed); }
+
+	// Before playback starts. rampSeconds is how long a change from 0 to 1
+	// takes; smaller changes take proportionally less.
+	void prepare(double sampleRate, double rampSeconds) noexcept
+	{
+		maxStepPerSample = rampSeconds > 0.0 && sampleRate > 0.0 ? (float)(1.0 / (rampSeconds * sampleRate)) : 1.0f;
+		current = get();
+	}
+
+	// Audio thread. Moves on by one block and returns the values at its start and end.
+	struct Ramp
+	{
+		float start = 0.0f;
+		float end = 0.0f;
+	};
+
+	Ramp advance(int numSamples) noexcept
+	{
+		const float start = current;
+		const float maxStep = maxStepPerSample * (float)numSamples;
+		current = juce::jlimit(start - maxStep, start + maxStep, get());
+		return { start, current };
+	}
+
+	// Audio thread. Advances by one block and applies it as a gain.
+	void applyGain(const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+	{
+		const auto ramp = advance(bufferToFill.numSamples);
+
+		if (ramp.start == 1.0f && ramp.end == 1.0f)
+			return;
+
+		if (ramp.start == ramp.end)
+			bufferToFill.buffer->applyGain(bufferToFill.startSample, bufferToFill.numSamples, ramp.end);
+		else
+			bufferToFill.buffer->applyGainRamp(bufferToFill.startSample, bufferToFill.numSamples, ramp.start, ramp.end);
+	}
+
+private:
+	std::atomic<float> target;
+
+	// Audio thread
+	float current;
+	float maxStepPerSample = 1.0f;
+};
+
+// Commands or records passed from one thread to another through a
+// fixed-size ring, e.g. from the message thread to the audio thread or back.
+// Neither side ever waits or allocates. The receiver takes everything that
+// has arrived, in order.
+template <typename Command, int capacity>
+class CommandQueue
+{
+public:
+	// Sending thread. Returns false, dropping the command, if the receiver
+	// has fallen capacity - 1 commands behind.
+	bool push(const Command& command) noexcept
+	{
+		const auto scope = fifo.write(1);
+
+		if (scope.blockSize1 == 0)
+			return false;
+
+		commands[(size_t)scope.startIndex1] = command;
+		return true;
+	}
+
+	// Receiving thread
+	template <typename Handler>
+	void drain(Handler&& handle) noexcept
+	{
+		const auto scope = fifo.read(fifo.getNumReady());
+		scope.forEach([&](int index) { handle(commands[(size_t)index]); });
+	}
+
+private:
+	juce::AbstractFifo fifo{ capacity };
+	std::array<Command, (size_t)capacity> commands{};
+};
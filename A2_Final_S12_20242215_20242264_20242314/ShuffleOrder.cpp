@@ -0,0 +1,109 @@
+#include "ShuffleOrder.h"
+
+void ShuffleOrder::reset(int numTracks, int currentTrack)
+{
+	order.resize((size_t)numTracks);
+	positions.resize((size_t)numTracks);
+
+	for (int i = 0; i < numTracks; ++i)
+		order[(size_t)i] = positions[(size_t)i] = i;
+
+	for (int i = numTracks - 1; i > 0; --i)
+		swapPositions(i, random.nextInt(i + 1));
+
+	lastPlayed = -1;
+	history.clear();
+	historyPosition = -1;
+
+	if (currentTrack >= 0 && currentTrack < numTracks)
+		moveTo(currentTrack);
+}
+
+void ShuffleOrder::addTrack()
+{
+	const int track = getNumTracks();
+	order.push_back(track);
+	positions.push_back(track);
+
+	const int firstToCome = lastPlayed + 1;
+	swapPositions(track, firstToCome + random.nextInt(track - firstToCome + 1));
+}
+
+int ShuffleOrder::peekNext(bool wrap) const
+{
+	if (historyPosition + 1 < (int)history.size())
+		return history[(size_t)historyPosition + 1];
+
+	if (lastPlayed + 1 < getNumTracks())
+		return order[(size_t)lastPlayed + 1];
+
+	return wrap && !order.empty() ? order[0] : -1;
+}
+
+void ShuffleOrder::moveTo(int track)
+{
+	jassert(track >= 0 && track < getNumTracks());
+
+	// Going forward again through tracks that previous went back over
+	if (historyPosition + 1 < (int)history.size() && history[(size_t)historyPosition + 1] == track)
+	{
+		++historyPosition;
+		return;
+	}
+
+	// Everything has been played, so start another round in the same order
+	if (lastPlayed + 1 == getNumTracks())
+		lastPlayed = -1;
+
+	// A track that's still to come joins the played ones. One that has
+	// already been played this round stays where it is.
+	if (positions[(size_t)track] > lastPlayed)
+		swapPositions(++lastPlayed, positions[(size_t)track]);
+
+	history.resize((size_t)historyPosition + 1);
+	history.push_back(track);
+
+	if ((int)history.size() > maxHistory)
+		history.pop_front();
+
+	historyPosition = (int)history.size() - 1;
+}
+
+int ShuffleOrder::stepBack(bool wrap)
+{
+	if (historyPosition > 0)
+		return history[(size_t)--historyPosition];
+
+	if (order.empty())
+		return -1;
+
+	const int current = historyPosition == 0 ? history[0] : -1;
+	const int position = current >= 0 ? positions[(size_t)current] : 0;
+	int previous = -1;
+
+	if (position > 0)
+		previous = order[(size_t)position - 1];
+	else if (wrap)
+		previous = order.back();
+
+	// Tracks reached this way go in front of what's been played, so next
+	// comes forward through them again
+	if (previous >= 0)
+	{
+		history.push_front(previous);
+
+		if ((int)history.size() > maxHistory)
+			history.pop_back();
+
+		historyPosition = 0;
+	}
+
+	return previous;
+}
+
+void ShuffleOrder::swapPositions(int a, int b)
+{
+	std::swap(order[(size_t)a], order[(size_t)b]);
+	positions[(size_t)order[(size_t)a]] = a;
+	positions[(size_t)order[(size_t)b]] = b;
+}
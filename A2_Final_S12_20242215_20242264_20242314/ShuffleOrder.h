@@ -0,0 +1,54 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ==================== SHUFFLE ORDER ====================
+
+// The order the playlist plays in while shuffling. Tracks are indices into
+// the playlist. The order is split into the tracks already played this round
+// and the ones still to come. Each track's position is kept alongside, so
+// moving between tracks never has to search the order. Tracks added while
+// shuffling go to a random place among the ones still to come.
+//
+// Previous goes back through the tracks as they were actually played,
+// including ones picked by hand, and next then retraces them before
+// carrying on with new tracks.
+class ShuffleOrder
+{
+public:
+	static constexpr int maxHistory = 1000;
+
+	// Shuffles tracks 0 to numTracks - 1. currentTrack, if not -1, counts as
+	// the first one played.
+	void reset(int numTracks, int currentTrack);
+
+	// Adds track getNumTracks()
+	void addTrack();
+
+	int getNumTracks() const { return (int)order.size(); }
+
+	// The track that follows the current one, or -1 at the end of the order
+	// unless wrap is set
+	int peekNext(bool wrap) const;
+
+	// Call when a track starts playing, other than by stepBack()
+	void moveTo(int track);
+
+	// Goes back to the track played before the current one and returns it.
+	// Without any history it steps back through the order instead, and
+	// returns -1 at its start unless wrap is set.
+	int stepBack(bool wrap);
+
+private:
+	std::vector<int> order;
+	std::vector<int> positions;
+
+	// Position in order of the last track played this round
+	int lastPlayed = -1;
+
+	std::deque<int> history;
+	int historyPosition = -1;
+
+	juce::Random random;
+
+	void swapPositions(int a, int b);
+};
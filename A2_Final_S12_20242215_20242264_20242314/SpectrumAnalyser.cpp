@@ -0,0 +1,103 @@
+#include "SpectrumAnalyser.h"
+
+SpectrumAnalyser::SpectrumAnalyser(juce::TimeSliceThread& backgroundThread)
+	: thread(backgroundThread)
+{
+	fifoSamples.allocate((size_t)fifoSize, true);
+	window.allocate((size_t)fftSize, true);
+	fftData.allocate((size_t)fftSize * 2, true);
+
+	thread.addTimeSliceClient(this);
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+	thread.removeTimeSliceClient(this);
+}
+
+void SpectrumAnalyser::pushSamples(const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+{
+	const int numChannels = bufferToFill.buffer->getNumChannels();
+	const int numSamples = bufferToFill.numSamples;
+
+	if (!active.load(std::memory_order_relaxed) || numChannels == 0 || fifo.getFreeSpace() < numSamples)
+		return;
+
+	const float scale = 1.0f / (float)numChannels;
+
+	// Mixed down to mono on the way in, which the ring's two parts each take
+	// as a vector multiply and an add per channel
+	auto copyMono = [&](int fifoIndex, int count, int offset)
+		{
+			if (count == 0)
+				return;
+
+			float* destination = fifoSamples + fifoIndex;
+			const int start = bufferToFill.startSample + offset;
+			juce::FloatVectorOperations::copyWithMultiply(destination, bufferToFill.buffer->getReadPointer(0, start), scale, count);
+
+			for (int channel = 1; channel < numChannels; ++channel)
+				juce::FloatVectorOperations::addWithMultiply(destination, bufferToFill.buffer->getReadPointer(channel, start), scale, count);
+		};
+
+	const auto scope = fifo.write(numSamples);
+	copyMono(scope.startIndex1, scope.blockSize1, 0);
+	copyMono(scope.startIndex2, scope.blockSize2, scope.blockSize1);
+}
+
+int SpectrumAnalyser::useTimeSlice()
+{
+	if (!active.load())
+	{
+		// Whatever was pushed before the display went away is stale
+		fifo.finishedRead(fifo.getNumReady());
+		return 100;
+	}
+
+	// If the thread has been held up, only the newest window still matters
+	if (const int excess = fifo.getNumReady() - fftSize; excess > 0)
+		fifo.finishedRead(excess);
+
+	if (fifo.getNumReady() < hopSize)
+		return 10;
+
+	while (fifo.getNumReady() >= hopSize)
+	{
+		std::memmove(window.get(), window + hopSize, sizeof(float) * (size_t)(fftSize - hopSize));
+		readFromFifo(window + (fftSize - hopSize), hopSize);
+		analyseWindow();
+	}
+
+	return 0;
+}
+
+void SpectrumAnalyser::readFromFifo(float* destination, int numSamples)
+{
+	const auto scope = fifo.read(numSamples);
+
+	if (scope.blockSize1 > 0)
+		juce::FloatVectorOperations::copy(destination, fifoSamples + scope.startIndex1, scope.blockSize1);
+
+	if (scope.blockSize2 > 0)
+		juce::FloatVectorOperations::copy(destination + scope.blockSize1, fifoSamples + scope.startIndex2, scope.blockSize2);
+}
+
+void SpectrumAnalyser::analyseWindow()
+{
+	juce::FloatVectorOperations::copy(fftData.get(), window.get(), fftSize);
+	juce::FloatVectorOperations::clear(fftData + fftSize, fftSize);
+	windowing.multiplyWithWindowingTable(fftData.get(), (size_t)fftSize);
+
+	fft.performFrequencyOnlyForwardTransform(fftData.get(), true);
+
+	// A full-scale sine comes out at fftSize / 2, halved by the Hann window
+	const float fullScale = (float)fftSize / 4.0f;
+
+	for (int bin = 0; bin < numBins; ++bin)
+		frame.decibels[(size_t)bin] = juce::Decibels::gainToDecibels(fftData[bin] / fullScale, -120.0f);
+
+	frame.sampleRate = currentSampleRate.load();
+
+	// Dropped if the display has stopped reading
+	frames.push(frame);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <JuceHeader.h>
+#include "RealtimeParameters.h"
+
+// ==================== SPECTRUM ANALYSER ====================
+
+// One low-priority background thread shared by every deck's analyser
+class SpectrumThread : public juce::TimeSliceThread
+{
+public:
+	SpectrumThread() : juce::TimeSliceThread("Spectrum Analysis")
+	{
+		startThread(juce::Thread::Priority::low);
+	}
+
+	~SpectrumThread() override
+	{
+		stopThread(2000);
+	}
+};
+
+// The spectrum of a deck's output. The audio thread only copies each block,
+// mixed down to mono, into a lock-free FIFO. The shared background thread
+// takes the samples from there, and every hopSize samples runs a
+// Hann-windowed FFT over the last fftSize of them. Finished frames are
+// handed to the display through a CommandQueue, so no FFT work lands on the
+// audio or message threads.
+//
+// Nothing is pushed or analysed while no display is showing the analyser.
+class SpectrumAnalyser : private juce::TimeSliceClient
+{
+public:
+	static constexpr int fftOrder = 11;
+	static constexpr int fftSize = 1 << fftOrder;
+	static constexpr int hopSize = fftSize / 2;
+	static constexpr int numBins = fftSize / 2;
+
+	// 0 dB is a full-scale sine
+	struct Frame
+	{
+		double sampleRate = 0.0;
+		std::array<float, numBins> decibels{};
+	};
+
+	explicit SpectrumAnalyser(juce::TimeSliceThread& backgroundThread);
+	~SpectrumAnalyser() override;
+
+	// Any thread. Doesn't allocate, so it is safe while the analysis runs.
+	void prepare(double sampleRate) noexcept { currentSampleRate.store(sampleRate); }
+
+	// Message thread
+	void setActive(bool shouldAnalyse) noexcept { active.store(shouldAnalyse); }
+	bool isActive() const noexcept { return active.load(); }
+
+	// Audio thread. If the background thread has fallen behind, the block is
+	// dropped rather than waited for.
+	void pushSamples(const juce::AudioSourceChannelInfo& bufferToFill) noexcept;
+
+	// Message thread, one reader only. Hands over every frame finished since
+	// the last call, oldest first.
+	template <typename Handler>
+	void readFrames(Handler&& handle) { frames.drain(std::forward<Handler>(handle)); }
+
+private:
+	juce::TimeSliceThread& thread;
+	std::atomic<bool> active{ false };
+	std::atomic<double> currentSampleRate{ 0.0 };
+
+	// Audio thread to background thread
+	static constexpr int fifoSize = fftSize * 4;
+	juce::AbstractFifo fifo{ fifoSize };
+	juce::HeapBlock<float> fifoSamples;
+
+	// Background thread. window holds the last fftSize samples.
+	juce::dsp::FFT fft{ fftOrder };
+	juce::dsp::WindowingFunction<float> windowing{ (size_t)fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+	juce::HeapBlock<float> window;
+	juce::HeapBlock<float> fftData;
+	Frame frame;
+
+	// Background thread to message thread
+	CommandQueue<Frame, 4> frames;
+
+	int useTimeSlice() override;
+	void readFromFifo(float* destination, int numSamples);
+	void analyseWindow();
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyser)
+};
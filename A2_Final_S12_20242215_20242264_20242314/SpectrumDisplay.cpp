@@ -0,0 +1,246 @@
+#include "SpectrumDisplay.h"
+
+namespace
+{
+	constexpr float fallDecibelsPerSecond = 60.0f;
+	constexpr double peakHoldSeconds = 1.0;
+	constexpr float peakFallDecibelsPerSecond = 15.0f;
+}
+
+SpectrumDisplay::SpectrumDisplay(SpectrumAnalyser& analyserToShow)
+	: analyser(analyserToShow)
+{
+	ThemeManager::getInstance().addListener(this);
+	setOpaque(true);
+}
+
+SpectrumDisplay::~SpectrumDisplay()
+{
+	analyser.setActive(false);
+	ThemeManager::getInstance().removeListener(this);
+}
+
+void SpectrumDisplay::visibilityChanged()
+{
+	// The analyser only runs while it is being shown
+	analyser.setActive(isVisible());
+
+	if (isVisible())
+	{
+		lastTickSeconds = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+		startTimerHz(30);
+	}
+	else
+	{
+		stopTimer();
+	}
+}
+
+void SpectrumDisplay::resized()
+{
+	const auto numColumns = (size_t)juce::jmax(0, getWidth() - 2);
+
+	levels.assign(numColumns, minimumDecibels);
+	peaks.assign(numColumns, minimumDecibels);
+	peaksHeldUntil.assign(numColumns, 0.0);
+	updateColumnBins(mappedSampleRate);
+}
+
+void SpectrumDisplay::setLogFrequency(bool shouldUseLogScale)
+{
+	logFrequency = shouldUseLogScale;
+	updateColumnBins(mappedSampleRate);
+	repaint();
+}
+
+void SpectrumDisplay::setPeakHold(bool shouldHoldPeaks)
+{
+	peakHold = shouldHoldPeaks;
+	std::fill(peaks.begin(), peaks.end(), minimumDecibels);
+	repaint();
+}
+
+void SpectrumDisplay::mouseDown(const juce::MouseEvent& e)
+{
+	if (e.mods.isShiftDown())
+		setLogFrequency(!logFrequency);
+	else
+		setPeakHold(!peakHold);
+}
+
+void SpectrumDisplay::updateColumnBins(double sampleRate)
+{
+	mappedSampleRate = sampleRate;
+	columnBins.resize(levels.size());
+
+	if (sampleRate <= 0.0)
+		return;
+
+	const float nyquist = (float)sampleRate * 0.5f;
+	const float binsPerHertz = (float)SpectrumAnalyser::fftSize / (float)sampleRate;
+	const float numColumns = (float)columnBins.size();
+
+	auto frequencyAt = [&](float column)
+		{
+			const float proportion = column / numColumns;
+			return logFrequency ? lowestFrequency * std::pow(nyquist / lowestFrequency, proportion) : nyquist * proportion;
+		};
+
+	for (size_t x = 0; x < columnBins.size(); ++x)
+	{
+		columnBins[x].start = frequencyAt((float)x) * binsPerHertz;
+		columnBins[x].end = frequencyAt((float)x + 1.0f) * binsPerHertz;
+	}
+}
+
+void SpectrumDisplay::applyFrame(const SpectrumAnalyser::Frame& frame, double now)
+{
+	if (frame.sampleRate != mappedSampleRate)
+		updateColumnBins(frame.sampleRate);
+
+	if (mappedSampleRate <= 0.0)
+		return;
+
+	const auto& decibels = frame.decibels;
+	const int lastBin = SpectrumAnalyser::numBins - 1;
+
+	for (size_t x = 0; x < columnBins.size(); ++x)
+	{
+		const auto& bins = columnBins[x];
+		float value;
+
+		if (bins.end - bins.start >= 1.0f)
+		{
+			// Several bins: the loudest of them
+			const int first = juce::jmin(lastBin, (int)bins.start);
+			const int end = juce::jlimit(first + 1, lastBin + 1, (int)std::ceil(bins.end));
+			value = *std::max_element(decibels.begin() + first, decibels.begin() + end);
+		}
+		else
+		{
+			// Less than a bin: interpolated between the two nearest
+			const float centre = juce::jmin((float)lastBin, (bins.start + bins.end) * 0.5f);
+			const int below = (int)centre;
+			const int above = juce::jmin(lastBin, below + 1);
+			value = juce::jmap(centre - (float)below, decibels[(size_t)below], decibels[(size_t)above]);
+		}
+
+		levels[x] = juce::jmax(levels[x], value);
+
+		if (peakHold && value >= peaks[x])
+		{
+			peaks[x] = value;
+			peaksHeldUntil[x] = now + peakHoldSeconds;
+		}
+	}
+}
+
+bool SpectrumDisplay::decay(double now, float elapsed)
+{
+	bool changed = false;
+
+	for (size_t x = 0; x < levels.size(); ++x)
+	{
+		if (levels[x] > minimumDecibels)
+		{
+			levels[x] = juce::jmax(minimumDecibels, levels[x] - fallDecibelsPerSecond * elapsed);
+			changed = true;
+		}
+
+		if (peaks[x] > minimumDecibels && now > peaksHeldUntil[x])
+		{
+			peaks[x] = juce::jmax(minimumDecibels, peaks[x] - peakFallDecibelsPerSecond * elapsed);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+void SpectrumDisplay::timerCallback()
+{
+	const double now = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+	const float elapsed = (float)(now - lastTickSeconds);
+	lastTickSeconds = now;
+
+	// A silent deck with everything at the floor doesn't repaint
+	bool changed = decay(now, elapsed);
+
+	analyser.readFrames([&](const SpectrumAnalyser::Frame& frame)
+		{
+			applyFrame(frame, now);
+			changed = true;
+		});
+
+	if (changed)
+		repaint();
+}
+
+float SpectrumDisplay::toY(float decibels) const
+{
+	const float proportion = (maximumDecibels - juce::jlimit(minimumDecibels, maximumDecibels, decibels))
+		/ (maximumDecibels - minimumDecibels);
+
+	return 1.0f + proportion * (float)(getHeight() - 2);
+}
+
+void SpectrumDisplay::paint(juce::Graphics& g)
+{
+	auto& colors = ThemeManager::getInstance().getColors();
+	g.fillAll(colors.secondaryBackground);
+
+	const float bottom = (float)getHeight() - 1.0f;
+
+	// 100 Hz, 1 kHz and 10 kHz
+	if (mappedSampleRate > 0.0 && !levels.empty())
+	{
+		const float nyquist = (float)mappedSampleRate * 0.5f;
+		g.setColour(colors.border);
+
+		for (const float frequency : { 100.0f, 1000.0f, 10000.0f })
+		{
+			const float proportion = logFrequency ? std::log(frequency / lowestFrequency) / std::log(nyquist / lowestFrequency)
+				: frequency / nyquist;
+
+			if (proportion < 1.0f)
+				g.drawVerticalLine(1 + juce::roundToInt(proportion * (float)levels.size()), 1.0f, bottom);
+		}
+	}
+
+	if (!levels.empty())
+	{
+		juce::Path spectrum;
+		spectrum.startNewSubPath(1.0f, bottom);
+
+		for (size_t x = 0; x < levels.size(); ++x)
+			spectrum.lineTo(1.5f + (float)x, toY(levels[x]));
+
+		spectrum.lineTo(1.0f + (float)levels.size(), bottom);
+		spectrum.closeSubPath();
+
+		g.setColour(colors.waveform.withAlpha(0.5f));
+		g.fillPath(spectrum);
+		g.setColour(colors.waveform);
+		g.strokePath(spectrum, juce::PathStrokeType(1.0f));
+
+		if (peakHold)
+		{
+			juce::Path peakLine;
+			peakLine.startNewSubPath(1.5f, toY(peaks.front()));
+
+			for (size_t x = 1; x < peaks.size(); ++x)
+				peakLine.lineTo(1.5f + (float)x, toY(peaks[x]));
+
+			g.setColour(colors.text.withAlpha(0.6f));
+			g.strokePath(peakLine, juce::PathStrokeType(1.0f));
+		}
+	}
+
+	g.setColour(colors.textSecondary);
+	g.setFont(10.0f);
+	g.drawText(juce::String(logFrequency ? "LOG" : "LIN") + (peakHold ? " HOLD" : ""),
+		getLocalBounds().reduced(4, 2), juce::Justification::topRight, false);
+
+	g.setColour(colors.border);
+	g.drawRect(getLocalBounds(), 1);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SpectrumAnalyser.h"
+#include "PlayerAudio.h"
+
+// ==================== SPECTRUM DISPLAY ====================
+
+// Draws a SpectrumAnalyser's frames, one value per pixel column. With a
+// log-frequency scale each column covers the same share of an octave, from
+// 20 Hz up to Nyquist. Where a column spans several FFT bins it shows the
+// loudest; where it falls between two bins it interpolates.
+//
+// Levels rise at once and fall back at a steady rate. With peak hold on,
+// each column's highest level is held for a moment and then falls slowly.
+// Clicking toggles peak hold, and shift-clicking switches between the log
+// and linear frequency scales.
+class SpectrumDisplay : public juce::Component,
+	private juce::Timer,
+	public ThemeManager::Listener
+{
+public:
+	explicit SpectrumDisplay(SpectrumAnalyser& analyserToShow);
+	~SpectrumDisplay() override;
+
+	void paint(juce::Graphics& g) override;
+	void resized() override;
+	void visibilityChanged() override;
+	void themeChanged() override { repaint(); }
+	void mouseDown(const juce::MouseEvent& e) override;
+
+	void setLogFrequency(bool shouldUseLogScale);
+	bool isLogFrequency() const { return logFrequency; }
+
+	void setPeakHold(bool shouldHoldPeaks);
+	bool isPeakHoldEnabled() const { return peakHold; }
+
+	static constexpr float minimumDecibels = -90.0f;
+	static constexpr float maximumDecibels = 0.0f;
+	static constexpr float lowestFrequency = 20.0f;
+
+private:
+	SpectrumAnalyser& analyser;
+
+	bool logFrequency = true;
+	bool peakHold = true;
+
+	// Per column: the range of FFT bins it covers, as fractional bin numbers
+	struct ColumnBins
+	{
+		float start = 0.0f;
+		float end = 0.0f;
+	};
+
+	std::vector<ColumnBins> columnBins;
+	double mappedSampleRate = 0.0;
+
+	std::vector<float> levels;
+	std::vector<float> peaks;
+	std::vector<double> peaksHeldUntil;
+	double lastTickSeconds = 0.0;
+
+	void timerCallback() override;
+	void updateColumnBins(double sampleRate);
+	void applyFrame(const SpectrumAnalyser::Frame& frame, double now);
+	bool decay(double now, float elapsed);
+	float toY(float decibels) const;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumDisplay)
+};
@@ -0,0 +1,143 @@
+#include "ThumbnailStore.h"
+
+ThumbnailStore::ThumbnailStore()
+	: juce::AudioThumbnailCache(16),
+	directory(juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+		.getChildFile("Audio Player Pro").getChildFile("Thumbnails"))
+{
+	directory.createDirectory();
+
+	preparingThumbnail = std::make_unique<juce::AudioThumbnail>(thumbnailResolution, formats->manager, *this);
+	getTimeSliceThread().addTimeSliceClient(this);
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+	getTimeSliceThread().removeTimeSliceClient(this);
+	preparingThumbnail.reset();
+}
+
+juce::int64 ThumbnailStore::hashFor(const juce::File& file)
+{
+	return hashFor(file, file.getSize(), file.getLastModificationTime().toMilliseconds());
+}
+
+juce::int64 ThumbnailStore::hashFor(const juce::File& file, juce::int64 size, juce::int64 modified)
+{
+	juce::String key;
+	key << file.getFullPathName() << '|' << size << '|' << modified;
+	return key.hashCode64();
+}
+
+juce::File ThumbnailStore::getFileFor(juce::int64 hashCode) const
+{
+	return directory.getChildFile(juce::String::toHexString(hashCode) + ".thumb");
+}
+
+void ThumbnailStore::prepare(const juce::File& file, juce::int64 hashCode)
+{
+	{
+		const juce::ScopedLock sl(prepareLock);
+		filesToPrepare.emplace_back(file, hashCode);
+	}
+
+	getTimeSliceThread().moveToFrontOfQueue(this);
+}
+
+bool ThumbnailStore::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+	const auto file = getFileFor(hashCode);
+
+	if (!file.existsAsFile())
+		return false;
+
+	juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+
+	if (mapped.getData() == nullptr)
+		return false;
+
+	juce::MemoryInputStream stream(mapped.getData(), mapped.getSize(), false);
+
+	if (!thumb.loadFrom(stream))
+	{
+		file.deleteFile();
+		return false;
+	}
+
+	// Pruning drops the entries that went unused the longest
+	file.setLastAccessTime(juce::Time::getCurrentTime());
+	return true;
+}
+
+void ThumbnailStore::saveNewThumb(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+	// Written next to the entry and moved over it, so a reader never sees half a file
+	juce::TemporaryFile temp(getFileFor(hashCode));
+
+	{
+		juce::FileOutputStream out(temp.getFile());
+
+		if (out.failedToOpen())
+			return;
+
+		thumb.saveTo(out);
+		out.flush();
+
+		if (out.getStatus().failed())
+			return;
+	}
+
+	temp.overwriteTargetFileWithTemporary();
+}
+
+void ThumbnailStore::prune()
+{
+	const auto entries = directory.findChildFiles(juce::File::findFiles, false, "*.thumb");
+
+	if (entries.size() <= maxStoredThumbnails)
+		return;
+
+	std::vector<std::pair<juce::Time, juce::File>> byLastUse;
+	byLastUse.reserve((size_t)entries.size());
+
+	for (const auto& entry : entries)
+		byLastUse.emplace_back(entry.getLastAccessTime(), entry);
+
+	std::sort(byLastUse.begin(), byLastUse.end(),
+		[](const auto& a, const auto& b) { return a.first < b.first; });
+
+	for (size_t i = 0; i < byLastUse.size() - (size_t)maxStoredThumbnails; ++i)
+		byLastUse[i].second.deleteFile();
+}
+
+int ThumbnailStore::useTimeSlice()
+{
+	if (!pruned)
+	{
+		pruned = true;
+		prune();
+	}
+
+	// The thumbnail scans on this same thread and stores itself when it's done
+	if (!preparingThumbnail->isFullyLoaded())
+		return 100;
+
+	juce::File file;
+	juce::int64 hashCode = 0;
+
+	{
+		const juce::ScopedLock sl(prepareLock);
+
+		if (filesToPrepare.empty())
+			return 500;
+
+		std::tie(file, hashCode) = filesToPrepare.front();
+		filesToPrepare.pop_front();
+	}
+
+	if (!getFileFor(hashCode).existsAsFile())
+		if (auto* reader = formats->manager.createReaderFor(file))
+			preparingThumbnail->setReader(reader, hashCode);
+
+	return 0;
+}
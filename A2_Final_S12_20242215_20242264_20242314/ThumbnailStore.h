@@ -0,0 +1,62 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DeckTrack.h"
+#include <deque>
+
+// ==================== THUMBNAIL STORE ====================
+
+// Waveform thumbnails kept on disk between sessions, shared by both decks and
+// the playlist. Each file gets one entry named after a hash of its path, size
+// and modification time, so an edited file simply stops matching its old
+// entry. Entries are JUCE's own thumbnail format (8-bit min/max pairs per
+// channel for every 512 source samples) and are read back through a memory
+// map, so reopening a known file costs a page-in rather than a full decode.
+// The hash is of the file's details rather than its contents, so a copy of a
+// track at another path gets a thumbnail of its own, but nothing has to read
+// the whole file just to look its thumbnail up.
+//
+// Thumbnails still being scanned are written out by the cache's own thread
+// once they are complete. Files handed to prepare() are scanned there in the
+// background too, ahead of being loaded into a deck.
+class ThumbnailStore : public juce::AudioThumbnailCache,
+	private juce::TimeSliceClient
+{
+public:
+	ThumbnailStore();
+	~ThumbnailStore() override;
+
+	static constexpr int thumbnailResolution = 512;
+	static constexpr int maxStoredThumbnails = 4096;
+
+	// The hash a thumbnail for this file is stored under
+	static juce::int64 hashFor(const juce::File& file);
+	static juce::int64 hashFor(const juce::File& file, juce::int64 size, juce::int64 modified);
+
+	// Queues a file to have its thumbnail built and stored in the background
+	// under hashCode, which the caller has from hashFor(). Files queued twice,
+	// or already stored, are skipped when their turn comes.
+	void prepare(const juce::File& file, juce::int64 hashCode);
+
+	bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+	void saveNewThumb(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+private:
+	juce::File directory;
+	juce::SharedResourcePointer<SharedAudioFormats> formats;
+
+	// Files waiting for prepare(), guarded by prepareLock: pushed on the
+	// message thread and popped on the cache's thread
+	std::deque<std::pair<juce::File, juce::int64>> filesToPrepare;
+	juce::CriticalSection prepareLock;
+
+	// The thumbnail that scans them. Outside the constructor and destructor,
+	// only touched on the cache's thread.
+	std::unique_ptr<juce::AudioThumbnail> preparingThumbnail;
+	bool pruned = false;
+
+	juce::File getFileFor(juce::int64 hashCode) const;
+	void prune();
+	int useTimeSlice() override;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ThumbnailStore)
+};
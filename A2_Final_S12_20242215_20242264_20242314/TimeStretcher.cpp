@@ -0,0 +1,447 @@
+#include "TimeStretcher.h"
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#elif JUCE_ARM && defined(__ARM_NEON)
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+	constexpr double frameSeconds = 0.04;
+
+	// Per quality: how far either side of its nominal position a frame may
+	// move, and the step of the coarse search pass
+	constexpr double searchRadiusSeconds[] = { 0.005, 0.010, 0.015 };
+	constexpr int searchStride[] = { 4, 2, 1 };
+}
+
+TimeStretcher::TimeStretcher(juce::AudioSource& sourceToStretch)
+	: source(sourceToStretch)
+{
+}
+
+void TimeStretcher::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+	currentSampleRate = sampleRate;
+	blockSize = samplesPerBlockExpected;
+
+	hopSize = juce::jmax(64, juce::roundToInt(sampleRate * frameSeconds * 0.5));
+	frameSize = hopSize * 2;
+	maxSearchRadius = juce::roundToInt(sampleRate * searchRadiusSeconds[(int)Quality::High]);
+
+	// Room for a frame either side of a full search range, plus the drift
+	// between where frames are read and where they were meant to be
+	const int inputCapacity = 2 * frameSize + 4 * hopSize + 4 * maxSearchRadius + blockSize;
+
+	input.setSize(numChannels, inputCapacity);
+	searchSignal.allocate((size_t)inputCapacity, true);
+
+	// Periodic Hann: two of them offset by half a frame sum to exactly 1
+	window.allocate((size_t)frameSize, false);
+	for (int i = 0; i < frameSize; ++i)
+		window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)i / (float)frameSize);
+
+	overlap.setSize(numChannels, frameSize);
+	output.setSize(numChannels, hopSize + blockSize);
+
+	clear();
+}
+
+void TimeStretcher::releaseResources()
+{
+	input.setSize(0, 0);
+	searchSignal.free();
+	window.free();
+	overlap.setSize(0, 0);
+	output.setSize(0, 0);
+	blockSize = 0;
+}
+
+void TimeStretcher::clear() noexcept
+{
+	numInput = 0;
+	continuation = 0;
+	analysisPosition = 0.0;
+	numOutput = 0;
+	overlap.clear();
+	stretching = false;
+	primed = false;
+}
+
+void TimeStretcher::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+	jassert(bufferToFill.numSamples <= blockSize);
+
+	if (resetPending.exchange(false))
+		clear();
+
+	const double currentSpeed = speed.load();
+
+	if (stretching && currentSpeed == 1.0)
+		stretching = false;
+	else if (!stretching && currentSpeed != 1.0)
+		beginStretching();
+
+	const int numSamples = bufferToFill.numSamples;
+	int written = popOutput(bufferToFill, 0);
+
+	if (stretching)
+	{
+		while (numOutput < numSamples - written)
+			processFrame(currentSpeed);
+
+		written += popOutput(bufferToFill, written);
+	}
+	else
+	{
+		// Input pulled in while stretching is played out as it is: the next
+		// frame would have continued it exactly anyway
+		written += popInput(bufferToFill, written);
+
+		if (written < numSamples)
+			source.getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer,
+				bufferToFill.startSample + written, numSamples - written));
+	}
+}
+
+juce::int64 TimeStretcher::getNumBufferedSamples() const noexcept
+{
+	if (!stretching)
+		return numOutput + (numInput - continuation);
+
+	const double pendingInput = numInput - analysisPosition - (primed ? 0 : hopSize);
+	return numOutput + (juce::int64)(juce::jmax(0.0, pendingInput) / speed.load());
+}
+
+void TimeStretcher::beginStretching() noexcept
+{
+	// Keep the input that hasn't been played yet and put half a frame of
+	// silence in front of it. The first frame's output is then all silence and
+	// is dropped, so the stretched audio starts exactly where the plain
+	// audio stopped.
+	const int pending = juce::jmin(numInput - continuation, input.getNumSamples() - hopSize);
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		auto* data = input.getWritePointer(channel);
+		std::memmove(data + hopSize, data + continuation, (size_t)pending * sizeof(float));
+		juce::FloatVectorOperations::clear(data, hopSize);
+	}
+
+	std::memmove(searchSignal + hopSize, searchSignal + continuation, (size_t)pending * sizeof(float));
+	juce::FloatVectorOperations::clear(searchSignal.get(), hopSize);
+
+	numInput = hopSize + pending;
+	continuation = 0;
+	analysisPosition = 0.0;
+	overlap.clear();
+	primed = false;
+	stretching = true;
+}
+
+void TimeStretcher::pullInput(int numSamples)
+{
+	jassert(numInput + numSamples <= input.getNumSamples());
+	numSamples = juce::jmin(numSamples, input.getNumSamples() - numInput);
+
+	while (numSamples > 0)
+	{
+		// The source is only prepared for blocks of up to blockSize
+		const int chunk = juce::jmin(numSamples, blockSize);
+		source.getNextAudioBlock(juce::AudioSourceChannelInfo(&input, numInput, chunk));
+
+		auto* mono = searchSignal + numInput;
+		juce::FloatVectorOperations::copy(mono, input.getReadPointer(0, numInput), chunk);
+		juce::FloatVectorOperations::add(mono, input.getReadPointer(1, numInput), chunk);
+
+		numInput += chunk;
+		numSamples -= chunk;
+	}
+}
+
+void TimeStretcher::processFrame(double currentSpeed)
+{
+	const int q = (int)quality.load();
+	const int radius = primed ? juce::roundToInt(currentSampleRate * searchRadiusSeconds[q]) : 0;
+	const int nominalStart = juce::roundToInt(analysisPosition);
+
+	pullInput(juce::jmax(continuation, nominalStart + radius) + frameSize - numInput);
+
+	const int start = primed ? findBestOffset(nominalStart, radius, searchStride[q]) : continuation;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+		juce::FloatVectorOperations::addWithMultiply(overlap.getWritePointer(channel),
+			input.getReadPointer(channel, start), window.get(), frameSize);
+
+	// The first half of the overlap has now had both of its frames added
+	if (primed)
+	{
+		for (int channel = 0; channel < numChannels; ++channel)
+			juce::FloatVectorOperations::copy(output.getWritePointer(channel, numOutput), overlap.getReadPointer(channel), hopSize);
+
+		numOutput += hopSize;
+	}
+
+	primed = true;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		auto* data = overlap.getWritePointer(channel);
+		juce::FloatVectorOperations::copy(data, data + hopSize, hopSize);
+		juce::FloatVectorOperations::clear(data + hopSize, hopSize);
+	}
+
+	continuation = start + hopSize;
+	analysisPosition += hopSize * currentSpeed;
+
+	// Keep enough history behind the next nominal position for its search
+	const int oldestNeeded = juce::jmin(continuation, (int)analysisPosition - maxSearchRadius);
+
+	if (oldestNeeded > 0)
+		discardInput(oldestNeeded);
+}
+
+int TimeStretcher::findBestOffset(int nominalStart, int radius, int stride) const noexcept
+{
+	// The new frame's first half is overlapped with the input that naturally
+	// follows the previous frame, so that is what it has to resemble
+	const float* target = searchSignal + continuation;
+	const int first = juce::jmax(0, nominalStart - radius);
+	const int last = juce::jmin(nominalStart + radius, numInput - frameSize);
+
+	if (last <= first)
+		return juce::jlimit(0, numInput - frameSize, nominalStart);
+
+	auto similarity = [&](int candidateStart)
+		{
+			const float* candidate = searchSignal + candidateStart;
+			return dotProduct(target, candidate, hopSize) / std::sqrt(dotProduct(candidate, candidate, hopSize) + 1.0e-9f);
+		};
+
+	int best = juce::jlimit(first, last, nominalStart);
+	float bestSimilarity = similarity(best);
+
+	for (int candidateStart = first; candidateStart <= last; candidateStart += stride)
+	{
+		const float s = similarity(candidateStart);
+
+		if (s > bestSimilarity)
+		{
+			bestSimilarity = s;
+			best = candidateStart;
+		}
+	}
+
+	// Refine the coarse pass sample by sample
+	if (stride > 1)
+	{
+		const int coarseBest = best;
+
+		for (int candidateStart = juce::jmax(first, coarseBest - stride + 1); candidateStart <= juce::jmin(last, coarseBest + stride - 1); ++candidateStart)
+		{
+			const float s = similarity(candidateStart);
+
+			if (s > bestSimilarity)
+			{
+				bestSimilarity = s;
+				best = candidateStart;
+			}
+		}
+	}
+
+	return best;
+}
+
+void TimeStretcher::discardInput(int numSamples) noexcept
+{
+	numInput -= numSamples;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		auto* data = input.getWritePointer(channel);
+		std::memmove(data, data + numSamples, (size_t)numInput * sizeof(float));
+	}
+
+	std::memmove(searchSignal.get(), searchSignal + numSamples, (size_t)numInput * sizeof(float));
+
+	continuation -= numSamples;
+	analysisPosition -= numSamples;
+}
+
+int TimeStretcher::popOutput(const juce::AudioSourceChannelInfo& bufferToFill, int offset) noexcept
+{
+	const int numSamples = juce::jmin(numOutput, bufferToFill.numSamples - offset);
+
+	if (numSamples <= 0)
+		return 0;
+
+	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+		juce::FloatVectorOperations::copy(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + offset),
+			output.getReadPointer(juce::jmin(channel, numChannels - 1)), numSamples);
+
+	numOutput -= numSamples;
+
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		auto* data = output.getWritePointer(channel);
+		std::memmove(data, data + numSamples, (size_t)numOutput * sizeof(float));
+	}
+
+	return numSamples;
+}
+
+int TimeStretcher::popInput(const juce::AudioSourceChannelInfo& bufferToFill, int offset) noexcept
+{
+	const int numSamples = juce::jmin(numInput - continuation, bufferToFill.numSamples - offset);
+
+	if (numSamples <= 0)
+		return 0;
+
+	for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+		juce::FloatVectorOperations::copy(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + offset),
+			input.getReadPointer(juce::jmin(channel, numChannels - 1), continuation), numSamples);
+
+	continuation += numSamples;
+
+	if (continuation == numInput)
+	{
+		numInput = 0;
+		continuation = 0;
+		analysisPosition = 0.0;
+	}
+
+	return numSamples;
+}
+
+float TimeStretcher::dotProduct(const float* a, const float* b, int numSamples) noexcept
+{
+	// This is where nearly all of the stretcher's time goes, so it gets two
+	// independent vector accumulators to keep the multiply-adds pipelined
+	int i = 0;
+	float sum = 0.0f;
+
+   #if JUCE_INTEL
+	auto acc0 = _mm_setzero_ps();
+	auto acc1 = _mm_setzero_ps();
+
+	for (; i + 8 <= numSamples; i += 8)
+	{
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+	sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+   #elif JUCE_ARM && defined(__ARM_NEON)
+	auto acc0 = vdupq_n_f32(0.0f);
+	auto acc1 = vdupq_n_f32(0.0f);
+
+	for (; i + 8 <= numSamples; i += 8)
+	{
+		acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+		acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+	}
+
+	const auto acc = vaddq_f32(acc0, acc1);
+	sum = vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1) + vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3);
+   #endif
+
+	for (; i < numSamples; ++i)
+		sum += a[i] * b[i];
+
+	return sum;
+}
+
+// ============================== Benchmark ==============================
+
+namespace
+{
+	// A second of stereo noise played round and round, so the alignment
+	// search has real work to do and the source itself costs next to nothing
+	class LoopedNoiseSource : public juce::AudioSource
+	{
+	public:
+		explicit LoopedNoiseSource(int lengthInSamples)
+			: noise(2, lengthInSamples)
+		{
+			juce::Random random(1);
+
+			for (int channel = 0; channel < noise.getNumChannels(); ++channel)
+				for (int i = 0; i < noise.getNumSamples(); ++i)
+					noise.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+		}
+
+		void prepareToPlay(int, double) override {}
+		void releaseResources() override {}
+
+		void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+		{
+			for (int done = 0; done < bufferToFill.numSamples;)
+			{
+				const int numSamples = juce::jmin(bufferToFill.numSamples - done, noise.getNumSamples() - position);
+
+				for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+					bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + done,
+						noise, channel % noise.getNumChannels(), position, numSamples);
+
+				done += numSamples;
+				position = (position + numSamples) % noise.getNumSamples();
+			}
+		}
+
+	private:
+		juce::AudioBuffer<float> noise;
+		int position = 0;
+	};
+}
+
+juce::String runTimeStretchBenchmark(double sampleRate, int blockSize, double secondsOfAudio)
+{
+	juce::String result;
+	result << "Time stretcher, " << juce::String(sampleRate / 1000.0, 1) << " kHz, " << blockSize
+		<< "-sample blocks (us per block, % of one core)\n";
+
+	juce::AudioBuffer<float> buffer(2, blockSize);
+	const juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+	const int numBlocks = juce::jmax(1, (int)(secondsOfAudio * sampleRate / blockSize));
+
+	const std::pair<TimeStretcher::Quality, const char*> qualities[] = {
+		{ TimeStretcher::Quality::Low, "Low" },
+		{ TimeStretcher::Quality::Medium, "Medium" },
+		{ TimeStretcher::Quality::High, "High" }
+	};
+
+	for (const auto& quality : qualities)
+	{
+		result << quality.second << ":";
+
+		for (const double speed : { 0.5, 0.75, 1.0, 1.25, 1.5, 2.0 })
+		{
+			LoopedNoiseSource source((int)sampleRate);
+			TimeStretcher stretcher(source);
+			stretcher.prepareToPlay(blockSize, sampleRate);
+			stretcher.setQuality(quality.first);
+			stretcher.setSpeed(speed);
+
+			juce::int64 ticks = 0;
+
+			for (int block = 0; block < numBlocks; ++block)
+			{
+				const auto start = juce::Time::getHighResolutionTicks();
+				stretcher.getNextAudioBlock(info);
+				ticks += juce::Time::getHighResolutionTicks() - start;
+			}
+
+			const double seconds = juce::Time::highResolutionTicksToSeconds(ticks);
+			result << (speed == 0.5 ? " " : ", ") << juce::String(speed, 2) << "x "
+				<< juce::String(seconds / numBlocks * 1.0e6, 2) << " us ("
+				<< juce::String(100.0 * seconds / (numBlocks * blockSize / sampleRate), 2) << "%)";
+		}
+
+		result << "\n";
+	}
+
+	return result;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Changes playback speed without changing pitch, using WSOLA (waveform
+// similarity overlap-add). The input is cut into Hann-windowed frames that
+// overlap by half; frames are read from the input 'speed' times faster than
+// they are written to the output, and each frame's read position is nudged
+// to the offset whose waveform best continues the previous frame, so the
+// overlaps add up coherently instead of phasing.
+//
+// At speed 1.0 the source is passed straight through. Switching in and out
+// of stretching is seamless: whatever was buffered is played out first.
+class TimeStretcher
+{
+public:
+	// How wide and how finely each frame's best offset is searched for
+	enum class Quality { Low, Medium, High };
+
+	static constexpr double minSpeed = 0.25;
+	static constexpr double maxSpeed = 4.0;
+
+	explicit TimeStretcher(juce::AudioSource& sourceToStretch);
+
+	void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+	void releaseResources();
+
+	// Audio thread
+	void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
+
+	// Audio thread: output samples still to come from audio that has already
+	// been pulled from the source
+	juce::int64 getNumBufferedSamples() const noexcept;
+
+	// Any thread
+	void setSpeed(double newSpeed) noexcept { speed.store(juce::jlimit(minSpeed, maxSpeed, newSpeed)); }
+	double getSpeed() const noexcept { return speed.load(); }
+
+	void setQuality(Quality newQuality) noexcept { quality.store(newQuality); }
+	Quality getQuality() const noexcept { return quality.load(); }
+
+	// Drops everything buffered, e.g. after the source has been repositioned.
+	// Takes effect at the start of the next block.
+	void reset() noexcept { resetPending.store(true); }
+
+private:
+	static constexpr int numChannels = 2;
+
+	juce::AudioSource& source;
+
+	std::atomic<double> speed{ 1.0 };
+	std::atomic<Quality> quality{ Quality::Medium };
+	std::atomic<bool> resetPending{ false };
+
+	double currentSampleRate = 0.0;
+	int blockSize = 0;
+	int frameSize = 0;
+	int hopSize = 0;
+	int maxSearchRadius = 0;
+
+	// Pulled from the source but not yet consumed. searchSignal is the mono
+	// mix of the same samples, which is what frames are aligned on.
+	juce::AudioBuffer<float> input;
+	juce::HeapBlock<float> searchSignal;
+	int numInput = 0;
+
+	// First input sample whose audio hasn't been output yet
+	int continuation = 0;
+	// Where the next frame would start if no alignment were done
+	double analysisPosition = 0.0;
+
+	juce::HeapBlock<float> window;
+	juce::AudioBuffer<float> overlap;
+	juce::AudioBuffer<float> output;
+	int numOutput = 0;
+
+	bool stretching = false;
+	bool primed = false;
+
+	void clear() noexcept;
+	void beginStretching() noexcept;
+	void pullInput(int numSamples);
+	void processFrame(double currentSpeed);
+	int findBestOffset(int nominalStart, int radius, int stride) const noexcept;
+	void discardInput(int numSamples) noexcept;
+	int popOutput(const juce::AudioSourceChannelInfo& bufferToFill, int offset) noexcept;
+	int popInput(const juce::AudioSourceChannelInfo& bufferToFill, int offset) noexcept;
+
+	static float dotProduct(const float* a, const float* b, int numSamples) noexcept;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimeStretcher)
+};
+
+// Times one deck's stretcher at each quality across 0.5x-2.0x on stereo
+// noise, and reports the cost per block and as a share of a core
+juce::String runTimeStretchBenchmark(double sampleRate = 44100.0, int blockSize = 512, double secondsOfAudio = 10.0);
@@ -0,0 +1,265 @@
+#include "LockFreeMixer.h"
+
+LockFreeMixer::LockFreeMixer()
+{
+}
+
+LockFreeMixer::~LockFreeMixer()
+{
+    removeAllInputs();
+}
+
+bool LockFreeMixer::addInputSource(juce::AudioSource* input)
+{
+    const auto& old = *current.load();
+
+    if (input == nullptr || std::find(old.inputs, old.inputs + old.numInputs, input) != old.inputs + old.numInputs)
+        return true;
+
+    if (old.numInputs >= maxInputs)
+        return false;
+
+    // التحضير قبل النشر، مثل MixerAudioSource، فلا يصل لخيط الصوت مدخل غير جاهز
+    if (currentSampleRate > 0.0)
+        input->prepareToPlay(blockSize, currentSampleRate);
+
+    Snapshot next = old;
+    next.inputs[next.numInputs++] = input;
+    publish(next);
+    return true;
+}
+
+void LockFreeMixer::removeInputSource(juce::AudioSource* input)
+{
+    const auto& old = *current.load();
+    Snapshot next;
+
+    for (int i = 0; i < old.numInputs; ++i)
+        if (old.inputs[i] != input)
+            next.inputs[next.numInputs++] = old.inputs[i];
+
+    if (next.numInputs == old.numInputs)
+        return;
+
+    publish(next);
+    input->releaseResources();
+}
+
+void LockFreeMixer::removeAllInputs()
+{
+    const Snapshot old = *current.load();
+    publish(Snapshot());
+
+    for (int i = 0; i < old.numInputs; ++i)
+        old.inputs[i]->releaseResources();
+}
+
+void LockFreeMixer::publish(const Snapshot& newSnapshot)
+{
+    auto* old = current.load();
+    auto* spare = old == &snapshots[0] ? &snapshots[1] : &snapshots[0];
+
+    // لا أحد يقرأ النسخة الاحتياطية: كل نشر سابق انتظر حتى تركها خيط الصوت
+    *spare = newSnapshot;
+    current.store(spare);
+
+    // فترة السماح: ننتظر (في خيط الرسائل فقط) حتى ينهي خيط الصوت أي استدعاء
+    // بدأ بالنسخة القديمة. أقصى مدة هي استدعاء صوت واحد.
+    while (inUse.load() == old)
+        juce::Thread::yield();
+}
+
+LockFreeMixer::Snapshot* LockFreeMixer::acquireSnapshot() noexcept
+{
+    // نعلن النسخة ثم نتأكد أنها ما زالت الحالية، وإلا فقد يكون الكاتب
+    // قد انتهى من انتظارها ونعيد المحاولة بالجديدة
+    for (;;)
+    {
+        auto* snapshot = current.load();
+        inUse.store(snapshot);
+
+        if (current.load() == snapshot)
+            return snapshot;
+    }
+}
+
+void LockFreeMixer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    blockSize = juce::jmax(1, samplesPerBlockExpected);
+    currentSampleRate = sampleRate;
+
+    // كل الذاكرة تُحجز هنا، وليس في getNextAudioBlock
+    tempBuffer.setSize(maxChannels, blockSize);
+
+    const auto& snapshot = *current.load();
+
+    for (int i = 0; i < snapshot.numInputs; ++i)
+        snapshot.inputs[i]->prepareToPlay(blockSize, sampleRate);
+}
+
+void LockFreeMixer::releaseResources()
+{
+    const auto& snapshot = *current.load();
+
+    for (int i = 0; i < snapshot.numInputs; ++i)
+        snapshot.inputs[i]->releaseResources();
+
+    tempBuffer.setSize(0, 0);
+    currentSampleRate = 0.0;
+}
+
+void LockFreeMixer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const auto& snapshot = *acquireSnapshot();
+
+    if (snapshot.numInputs == 0 || tempBuffer.getNumSamples() == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        inUse.store(nullptr);
+        return;
+    }
+
+    // المدخل الأول يكتب مباشرة في المخرج، والباقي في tempBuffer ثم يُجمع.
+    // الكتل الأكبر من المتوقع تُقسم بدل تكبير tempBuffer هنا.
+    const int numChannels = juce::jmin(bufferToFill.buffer->getNumChannels(), maxChannels);
+
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += blockSize)
+    {
+        const int numSamples = juce::jmin(blockSize, bufferToFill.numSamples - offset);
+        const juce::AudioSourceChannelInfo chunk(bufferToFill.buffer, bufferToFill.startSample + offset, numSamples);
+
+        snapshot.inputs[0]->getNextAudioBlock(chunk);
+
+        // نافذة على tempBuffer بعدد قنوات المخرج فقط (بدون حجز ذاكرة)
+        juce::AudioBuffer<float> temp(tempBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        for (int i = 1; i < snapshot.numInputs; ++i)
+        {
+            snapshot.inputs[i]->getNextAudioBlock(juce::AudioSourceChannelInfo(&temp, 0, numSamples));
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                bufferToFill.buffer->addFrom(channel, chunk.startSample, temp, channel, 0, numSamples);
+        }
+    }
+
+    inUse.store(nullptr);
+}
+
+// ============================== Benchmark ==============================
+
+namespace
+{
+    // مدخل رخيص (قيمة ثابتة) حتى يظهر فرق المازجين نفسيهما
+    class ConstantSource : public juce::AudioSource
+    {
+    public:
+        explicit ConstantSource(float levelToUse) : level(levelToUse) {}
+
+        void prepareToPlay(int, double) override {}
+        void releaseResources() override {}
+
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+        {
+            for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+                juce::FloatVectorOperations::fill(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample),
+                    level, bufferToFill.numSamples);
+        }
+
+    private:
+        float level;
+    };
+
+    struct Timing
+    {
+        double averageUs = 0.0;
+        double worstUs = 0.0;
+    };
+
+    template <typename Mixer>
+    Timing timeMixer(Mixer& mixer, juce::AudioSource& churnInput, bool churn, int blockSize, int numCallbacks)
+    {
+        juce::AudioBuffer<float> output(2, blockSize);
+        const juce::AudioSourceChannelInfo info(&output, 0, blockSize);
+
+        // خيط يضيف ويحذف مدخلاً طوال القياس، كما يحدث عند تحميل مشغل أو إزالته
+        std::atomic<bool> running{ true };
+        std::thread churner([&]
+            {
+                while (churn && running.load())
+                {
+                    mixer.addInputSource(&churnInput, false);
+                    mixer.removeInputSource(&churnInput);
+                }
+            });
+
+        Timing timing;
+        double totalTicks = 0.0;
+        juce::int64 worstTicks = 0;
+
+        for (int i = 0; i < numCallbacks; ++i)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            mixer.getNextAudioBlock(info);
+            const auto ticks = juce::Time::getHighResolutionTicks() - start;
+
+            totalTicks += (double)ticks;
+            worstTicks = juce::jmax(worstTicks, ticks);
+        }
+
+        running.store(false);
+        churner.join();
+
+        const double usPerTick = 1.0e6 / (double)juce::Time::getHighResolutionTicksPerSecond();
+        timing.averageUs = totalTicks / numCallbacks * usPerTick;
+        timing.worstUs = (double)worstTicks * usPerTick;
+        return timing;
+    }
+
+    // نفس واجهة MixerAudioSource حتى يُقاس المازجان بنفس الكود
+    struct LockFreeMixerAdapter
+    {
+        LockFreeMixer mixer;
+
+        void addInputSource(juce::AudioSource* input, bool) { mixer.addInputSource(input); }
+        void removeInputSource(juce::AudioSource* input) { mixer.removeInputSource(input); }
+        void prepareToPlay(int blockSize, double sampleRate) { mixer.prepareToPlay(blockSize, sampleRate); }
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) { mixer.getNextAudioBlock(info); }
+    };
+}
+
+juce::String runMixerBenchmark(int numInputs, int blockSize, int numCallbacks)
+{
+    juce::OwnedArray<ConstantSource> inputs;
+    ConstantSource churnInput(0.01f);
+
+    for (int i = 0; i < numInputs; ++i)
+        inputs.add(new ConstantSource(0.01f * (float)(i + 1)));
+
+    juce::MixerAudioSource juceMixer;
+    LockFreeMixerAdapter lockFreeMixer;
+
+    for (auto* input : inputs)
+    {
+        juceMixer.addInputSource(input, false);
+        lockFreeMixer.addInputSource(input, false);
+    }
+
+    juceMixer.prepareToPlay(blockSize, 48000.0);
+    lockFreeMixer.prepareToPlay(blockSize, 48000.0);
+
+    juce::String result;
+    result << numInputs << " inputs, " << blockSize << " samples, " << numCallbacks << " callbacks (us per callback)\n";
+
+    for (const bool churn : { false, true })
+    {
+        const auto juceTiming = timeMixer(juceMixer, churnInput, churn, blockSize, numCallbacks);
+        const auto lockFreeTiming = timeMixer(lockFreeMixer, churnInput, churn, blockSize, numCallbacks);
+
+        result << (churn ? "with add/remove: " : "steady:          ")
+               << "MixerAudioSource avg " << juce::String(juceTiming.averageUs, 2) << " worst " << juce::String(juceTiming.worstUs, 1)
+               << ", LockFreeMixer avg " << juce::String(lockFreeTiming.averageUs, 2) << " worst " << juce::String(lockFreeTiming.worstUs, 1) << "\n";
+    }
+
+    juceMixer.removeAllInputs();
+    return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// مازج بعدد ثابت من المداخل، بديل لـ juce::MixerAudioSource لا يقفل خيط الصوت أبداً.
+// قائمة المداخل تُنشر كنسخة كاملة (snapshot) عبر مؤشر atomic بأسلوب RCU:
+// خيط الرسائل يكتب النسخة الجديدة في مكان احتياطي ثم يبدّل المؤشر،
+// وخيط الصوت يقرأ النسخة الحالية فقط دون انتظار أو حجز ذاكرة.
+class LockFreeMixer : public juce::AudioSource
+{
+public:
+    static constexpr int maxInputs = 16;
+    static constexpr int maxChannels = 8;
+
+    LockFreeMixer();
+    ~LockFreeMixer() override;
+
+    // من خيط الرسائل فقط. المازج لا يملك المداخل.
+    // ترجع false إذا كان المازج ممتلئاً
+    bool addInputSource(juce::AudioSource* input);
+
+    // بعد رجوع الدالة لا يستعمل خيط الصوت المدخل المحذوف، فيمكن حذفه مباشرة
+    void removeInputSource(juce::AudioSource* input);
+    void removeAllInputs();
+
+    int getNumInputs() const { return current.load()->numInputs; }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+private:
+    struct Snapshot
+    {
+        int numInputs = 0;
+        juce::AudioSource* inputs[maxInputs] = {};
+    };
+
+    // نسختان تكفيان: الكاتب ينتظر بعد كل نشر حتى يترك خيط الصوت النسخة القديمة
+    Snapshot snapshots[2];
+    std::atomic<Snapshot*> current{ &snapshots[0] };
+
+    // النسخة التي يقرأها خيط الصوت الآن (hazard pointer)، أو nullptr
+    std::atomic<Snapshot*> inUse{ nullptr };
+
+    juce::AudioBuffer<float> tempBuffer;
+    int blockSize = 0;
+    double currentSampleRate = 0.0;
+
+    Snapshot* acquireSnapshot() noexcept;
+    void publish(const Snapshot& newSnapshot);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LockFreeMixer)
+};
+
+// يقيس متوسط وأسوأ زمن للاستدعاء الواحد لهذا المازج ولـ juce::MixerAudioSource
+// بنفس المداخل، مرة بدون تعديل ومرة مع إضافة وحذف مدخل باستمرار من خيط آخر
+juce::String runMixerBenchmark(int numInputs = 8, int blockSize = 256, int numCallbacks = 20000);
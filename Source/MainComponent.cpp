@@ -11,8 +11,12 @@ MainComponent::MainComponent()
     addAndMakeVisible(player2.get());
 
     // إضافة المشغلين إلى المازج
-    mixerSource.addInputSource(player1.get(), false);
-    mixerSource.addInputSource(player2.get(), false);
+    mixerSource.addInputSource(player1.get());
+    mixerSource.addInputSource(player2.get());
+
+    // لمقارنة المازج مع MixerAudioSource: شغّل البرنامج مع --mixer-benchmark
+    if (juce::JUCEApplicationBase::getCommandLineParameters().contains("--mixer-benchmark"))
+        juce::Logger::writeToLog(runMixerBenchmark());
 
     setSize(1200, 600);
     setAudioChannels(0, 2);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "LockFreeMixer.h"
 
 class PlayerGUI;
 
@@ -19,7 +20,8 @@ private:
     std::unique_ptr<PlayerGUI> player1;
     std::unique_ptr<PlayerGUI> player2;
     
-    juce::MixerAudioSource mixerSource;
+    // لا يقفل خيط الصوت عند إضافة أو إزالة مشغل
+    LockFreeMixer mixerSource;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
\ No newline at end of file